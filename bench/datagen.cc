@@ -0,0 +1,174 @@
+#include "datagen.h"
+#include "../include/db.h"
+#include <algorithm>
+#include <ctime>
+#include <random>
+
+namespace {
+
+const char *const first_names[] = {
+    "Ana", "João", "Maria", "Pedro", "Sofia", "Tiago", "Inês", "Rui", "Carla", "Miguel",
+    "Beatriz", "Luís", "Marta", "Nuno", "Rita", "André", "Catarina", "Paulo", "Joana", "Ricardo",
+};
+const char *const last_names[] = {
+    "Silva", "Santos", "Ferreira", "Pereira", "Oliveira", "Costa", "Rodrigues", "Martins",
+    "Sousa", "Fernandes", "Gonçalves", "Gomes", "Lopes", "Marques", "Alves", "Almeida",
+};
+const char *const equipment[] = {
+    "Portátil Lenovo ThinkPad T14", "Portátil HP EliteBook 840", "MacBook Air M1",
+    "iPhone 12", "Samsung Galaxy S21", "Impressora Epson EcoTank", "Desktop Dell OptiPlex",
+    "Monitor LG 27\"", "Tablet iPad 9", "Router TP-Link Archer",
+};
+const char *const problems[] = {
+    "Não liga", "Ecrã partido", "Bateria não carrega", "Muito lento, possível vírus",
+    "Teclado com teclas presas", "Sobreaquece e desliga", "Não deteta Wi-Fi",
+    "Formatação e reinstalação do sistema", "Substituição de disco por SSD", "Porta USB danificada",
+};
+
+constexpr size_t BATCH = 100000;
+constexpr time_t FIVE_YEARS = 5 * 365 * 24 * 3600;
+
+template<class T, size_t N>
+const T &pick(std::mt19937_64 &rng, const T (&list)[N]) {
+    return list[rng() % N];
+}
+
+std::string format_time(time_t t) {
+    char buf[32];
+    std::tm tm{};
+    gmtime_r(&t, &tm);
+    strftime(buf, sizeof buf, "%Y-%m-%d %H:%M:%S", &tm);
+    return buf;
+}
+
+// Old orders are almost all closed; open work sits in the newest few percent.
+ServiceStatus status_for_age(double age, std::mt19937_64 &rng) {
+    double r = std::uniform_real_distribution<double>(0, 1)(rng);
+    if (age > 0.05) return r < 0.9 ? ServiceStatus::Delivered : ServiceStatus::Canceled;
+    if (r < 0.30) return ServiceStatus::Open;
+    if (r < 0.50) return ServiceStatus::Diagnosing;
+    if (r < 0.75) return ServiceStatus::Repair;
+    if (r < 0.95) return ServiceStatus::Done;
+    return ServiceStatus::Delivered;
+}
+
+// One order created at position i of total, spread over the five years
+// before now. Leaves service_id and created_by_id to the caller.
+ServiceRow make_service(size_t i, size_t total, time_t now, std::mt19937_64 &rng) {
+    // ids and dates grow together, as they do in the live table
+    time_t created = now - FIVE_YEARS + time_t(double(FIVE_YEARS) * i / total) + time_t(rng() % 600);
+    double age = double(now - created) / FIVE_YEARS;
+    ServiceRow row;
+    row.client_name = std::string(pick(rng, first_names)) + " " + pick(rng, last_names);
+    // one number rather than "9" + ..., which trips GCC 12's -Wrestrict
+    row.phone_number = std::to_string(910000000 + rng() % 90000000);
+    row.email = "cliente" + std::to_string(i) + "@mail.pt";
+    row.equipment = pick(rng, equipment);
+    row.problem_report = pick(rng, problems);
+    row.status = status_for_age(age, rng);
+    row.created_at = created;
+    // closed within a fortnight of arriving
+    if (is_closed(row.status)) row.closed_at = std::min<time_t>(now, created + time_t(rng() % (14 * 86400)));
+    return row;
+}
+
+}
+
+std::vector<ServiceSummary> generate_rows(size_t services, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    const time_t now = time(nullptr);
+    std::vector<ServiceSummary> rows;
+    rows.reserve(services);
+    for (size_t i = 0; i < services; i++) {
+        rows.push_back(make_service(i, services, now, rng));
+        rows.back().service_id = int(i + 1);
+    }
+    return rows;
+}
+
+Dataset generate_dataset(const DatasetSpec &spec, sqlite3 *db) {
+    Dataset out;
+    std::mt19937_64 rng(spec.seed);
+    std::vector<int> staff_ids;     // admins and commercials open the orders
+
+    sqlite3_stmt *user_stmt = nullptr;
+    sqlite3_prepare_v2(db,
+        "INSERT INTO users (full_name, email, username, access_code_hash, role_id) VALUES (?, ?, ?, ?, ?);",
+        -1, &user_stmt, nullptr);
+    execute_query("BEGIN;", db);
+    for (size_t i = 0; i < spec.users; i++) {
+        int role = i < 2 ? 1 : (i % 10 < 3 ? 2 : 3);
+        std::string first = pick(rng, first_names), last = pick(rng, last_names);
+        std::string full_name = first + " " + last;
+        std::string username = "user" + std::to_string(i);
+        std::string code = "code" + std::to_string(i);
+        std::string email = username + "@example.pt";
+        sqlite3_bind_text(user_stmt, 1, full_name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(user_stmt, 2, email.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(user_stmt, 3, username.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(user_stmt, 4, code.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(user_stmt, 5, role);
+        if (sqlite3_step(user_stmt) == SQLITE_DONE) {
+            int id = (int)sqlite3_last_insert_rowid(db);
+            (role == 3 ? out.technician_ids : staff_ids).push_back(id);
+            out.usernames.push_back(username);
+            out.access_codes.push_back(code);
+        }
+        sqlite3_reset(user_stmt);
+    }
+    execute_query("COMMIT;", db);
+    sqlite3_finalize(user_stmt);
+    if (staff_ids.empty()) staff_ids.push_back(1);
+
+    sqlite3_stmt *service_stmt = nullptr;
+    sqlite3_prepare_v2(db,
+        "INSERT INTO services (client_name, client_phone, client_email, equipment_desc, problem_report, "
+        "created_by_id, status, created_at, closed_at) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);",
+        -1, &service_stmt, nullptr);
+    sqlite3_stmt *assign_stmt = nullptr;
+    sqlite3_prepare_v2(db,
+        "INSERT INTO service_technicians (service_id, technician_id, assigned_at) VALUES (?, ?, ?);",
+        -1, &assign_stmt, nullptr);
+
+    // index and count once at the end rather than row by row
+    suspend_search_index(db);
+    suspend_service_counts(db);
+    const time_t now = time(nullptr);
+    std::bernoulli_distribution assigned(spec.assigned_fraction);
+
+    execute_query("BEGIN;", db);
+    for (size_t i = 0; i < spec.services; i++) {
+        if (i > 0 && i % BATCH == 0) execute_query("COMMIT; BEGIN;", db);
+        ServiceRow row = make_service(i, spec.services, now, rng);
+
+        sqlite3_bind_text(service_stmt, 1, row.client_name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(service_stmt, 2, row.phone_number.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(service_stmt, 3, row.email.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(service_stmt, 4, row.equipment.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(service_stmt, 5, row.problem_report.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(service_stmt, 6, staff_ids[rng() % staff_ids.size()]);
+        sqlite3_bind_int(service_stmt, 7, int(row.status));
+        sqlite3_bind_int64(service_stmt, 8, row.created_at);
+        if (row.closed_at) sqlite3_bind_int64(service_stmt, 9, *row.closed_at);
+        else sqlite3_bind_null(service_stmt, 9);
+        if (sqlite3_step(service_stmt) == SQLITE_DONE) out.services++;
+        sqlite3_reset(service_stmt);
+
+        if (!out.technician_ids.empty() && assigned(rng)) {
+            std::string assigned_at = format_time(row.created_at);
+            sqlite3_bind_int64(assign_stmt, 1, sqlite3_last_insert_rowid(db));
+            sqlite3_bind_int(assign_stmt, 2, out.technician_ids[rng() % out.technician_ids.size()]);
+            sqlite3_bind_text(assign_stmt, 3, assigned_at.c_str(), -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(assign_stmt) == SQLITE_DONE) out.assignments++;
+            sqlite3_reset(assign_stmt);
+        }
+    }
+    execute_query("COMMIT;", db);
+    sqlite3_finalize(service_stmt);
+    sqlite3_finalize(assign_stmt);
+
+    init_search_index(db);
+    init_service_counts(db);
+    execute_query("ANALYZE;", db);
+    return out;
+}
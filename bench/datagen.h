@@ -0,0 +1,31 @@
+#pragma once
+#include <sqlite3.h>
+#include "../include/db.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct DatasetSpec {
+    size_t users = 200;
+    size_t services = 10000;
+    double assigned_fraction = 0.7;     // services with a technician
+    uint64_t seed = 42;
+};
+
+// What the benchmark needs to know about the generated data.
+struct Dataset {
+    std::vector<int> technician_ids;
+    std::vector<std::string> usernames;
+    std::vector<std::string> access_codes;   // parallel to usernames
+    size_t services = 0;
+    size_t assignments = 0;
+};
+
+// Fills an initialized, empty database with users and services shaped like
+// the real ones: Portuguese names, mostly delivered orders spread over five
+// years, and about assigned_fraction of them assigned to a technician.
+Dataset generate_dataset(const DatasetSpec &spec, sqlite3 *db);
+
+// The same kind of orders as generate_dataset, in memory only and as the
+// lists hold them, with ids 1..services in creation order.
+std::vector<ServiceSummary> generate_rows(size_t services, uint64_t seed);
@@ -0,0 +1,276 @@
+// Times the db.cc entry points against a generated dataset and prints one
+// JSON document to stdout. Diagnostics go to stderr.
+//
+//   sgos_bench [--services N] [--users N] [--iterations N]
+//              [--list-iterations N] [--seed N] [--db PATH] [--trace 0|1]
+//
+// Exits with status 1 when a query in db.cc plans a full table scan.
+// Allocations are counted across operator new and SQLite's allocator.
+#include "datagen.h"
+#include "../include/db.h"
+#include "../include/json.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+}
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+namespace {
+
+sqlite3_mem_methods sqlite_allocator;
+
+void *counting_malloc(int size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return sqlite_allocator.xMalloc(size);
+}
+
+void *counting_realloc(void *p, int size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return sqlite_allocator.xRealloc(p, size);
+}
+
+// Must run before SQLite initializes, i.e. before the first connection.
+void count_sqlite_allocations() {
+    sqlite3_config(SQLITE_CONFIG_GETMALLOC, &sqlite_allocator);
+    sqlite3_mem_methods counting = sqlite_allocator;
+    counting.xMalloc = counting_malloc;
+    counting.xRealloc = counting_realloc;
+    sqlite3_config(SQLITE_CONFIG_MALLOC, &counting);
+}
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    DatasetSpec dataset;
+    size_t iterations = 2000;        // point lookups and writes
+    size_t list_iterations = 5;      // whole-table reads
+    std::string path = "sgos_bench.db";
+    bool trace = true;               // DbConfig::trace, to measure its cost
+};
+
+struct Result {
+    std::string op;
+    size_t ops = 0;
+    double seconds = 0;
+    double p50_us = 0;
+    double p99_us = 0;
+    size_t rows = 0;                 // rows returned per call, for list reads
+    double allocs = 0;               // heap allocations per call
+};
+
+double percentile(std::vector<double> &sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t idx = std::min(sorted.size() - 1, size_t(p * (sorted.size() - 1) + 0.5));
+    return sorted[idx];
+}
+
+// Calls fn(i) for i in [0, n) and records each call's latency. fn returns
+// the number of rows it produced.
+template<class F>
+Result measure(const std::string &op, size_t n, F fn) {
+    Result r;
+    r.op = op;
+    r.ops = n;
+    std::vector<double> samples;
+    samples.reserve(n);
+    uint64_t allocs_before = allocations.load(std::memory_order_relaxed);
+    auto begin = Clock::now();
+    for (size_t i = 0; i < n; i++) {
+        auto t0 = Clock::now();
+        r.rows = fn(i);
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+    }
+    r.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    if (n > 0) r.allocs = double(allocations.load(std::memory_order_relaxed) - allocs_before) / n;
+    std::sort(samples.begin(), samples.end());
+    r.p50_us = percentile(samples, 0.50);
+    r.p99_us = percentile(samples, 0.99);
+    return r;
+}
+
+bool parse_args(int argc, char *argv[], Options &o) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 == argc) return false;
+        const char *value = argv[++i];
+        if (arg == "--services") o.dataset.services = strtoull(value, nullptr, 10);
+        else if (arg == "--users") o.dataset.users = strtoull(value, nullptr, 10);
+        else if (arg == "--iterations") o.iterations = strtoull(value, nullptr, 10);
+        else if (arg == "--list-iterations") o.list_iterations = strtoull(value, nullptr, 10);
+        else if (arg == "--seed") o.dataset.seed = strtoull(value, nullptr, 10);
+        else if (arg == "--db") o.path = value;
+        else if (arg == "--trace") o.trace = strtoul(value, nullptr, 10) != 0;
+        else return false;
+    }
+    return o.dataset.users > 0;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    Options o;
+    if (!parse_args(argc, argv, o)) {
+        fprintf(stderr, "usage: %s [--services N] [--users N] [--iterations N] "
+                        "[--list-iterations N] [--seed N] [--db PATH] [--trace 0|1]\n", argv[0]);
+        return 2;
+    }
+    count_sqlite_allocations();
+    for (const char *suffix : {"", "-wal", "-shm"}) remove((o.path + suffix).c_str());
+    DbConfig config;
+    config.trace = o.trace;
+    if (!open_path(o.path, db, config)) return 1;
+    initDatabase(db);
+
+    auto gen_begin = Clock::now();
+    Dataset data = generate_dataset(o.dataset, db);
+    double gen_seconds = std::chrono::duration<double>(Clock::now() - gen_begin).count();
+    std::vector<std::string> scans = unindexed_scans(db);
+
+    std::mt19937_64 rng(o.dataset.seed + 1);
+    auto random_user = [&] { return rng() % data.usernames.size(); };
+    auto random_service = [&] { return int(1 + rng() % std::max<size_t>(data.services, 1)); };
+    int technician = data.technician_ids.empty() ? 0 : data.technician_ids.front();
+    std::vector<int> added;
+
+    std::vector<Result> results;
+    results.push_back(measure("get_services", o.list_iterations, [&](size_t) {
+        return get_services(db, 0).size();
+    }));
+    results.push_back(measure("get_services_assigned", o.list_iterations, [&](size_t) {
+        return get_services(db, technician).size();
+    }));
+    // the streaming read reuses one row, so its strings stop allocating
+    results.push_back(measure("for_each_service", o.list_iterations, [&](size_t) {
+        size_t rows = 0;
+        for_each_service(db, 0, [&rows](const ServiceSummary &) { rows++; return true; });
+        return rows;
+    }));
+    results.push_back(measure("get_services_page", o.iterations, [&](size_t) {
+        return get_services_page(db, 0, std::nullopt, 200).rows.size();
+    }));
+    // one month, two years back: a range of idx_services_created
+    TimeRange month;
+    month.from = sqlite3_int64(time(nullptr)) - 2 * 365 * 86400;
+    month.to = month.from + 30 * 86400;
+    results.push_back(measure("get_services_page_month", o.iterations, [&](size_t) {
+        return get_services_page(db, 0, std::nullopt, 200, month).rows.size();
+    }));
+    results.push_back(measure("count_services_by_status", o.iterations, [&](size_t) {
+        return count_services_by_status(db).size();
+    }));
+    results.push_back(measure("get_service_counts", o.iterations, [&](size_t) {
+        return get_service_counts(7, db).technicians.size();
+    }));
+    results.push_back(measure("get_users", o.iterations, [&](size_t) {
+        return get_users(db).size();
+    }));
+    results.push_back(measure("user_exists", o.iterations, [&](size_t i) {
+        // every other lookup misses
+        std::string name = i % 2 ? data.usernames[random_user()] : "nobody" + std::to_string(i);
+        return size_t(user_exists(name, db));
+    }));
+    results.push_back(measure("try_login", o.iterations, [&](size_t) {
+        size_t u = random_user();
+        return size_t(try_login(data.usernames[u], data.access_codes[u]).has_value());
+    }));
+    results.push_back(measure("add_service", o.iterations, [&](size_t i) {
+        bool ok = add_service("Bench Client " + std::to_string(i), "910000000", "bench@mail.pt",
+                              "Portátil", "Não liga", 1, db);
+        if (ok) added.push_back(int(sqlite3_last_insert_rowid(db)));
+        return size_t(ok);
+    }));
+    // edits move each service one step along its lifecycle where it can
+    // go on, so most of them also append to the timeline
+    std::vector<ServiceStatus> statuses(data.services + 1);
+    for_each_service(db, 0, [&](const ServiceSummary &s) {
+        if (size_t(s.service_id) < statuses.size()) statuses[s.service_id] = s.status;
+        return true;
+    });
+    auto edited = [&](size_t i) {
+        ServiceRow row;
+        row.service_id = random_service();
+        row.client_name = "Edited Client " + std::to_string(i);
+        row.phone_number = "920000000";
+        row.email = "edit@mail.pt";
+        row.equipment = "Desktop";
+        row.problem_report = "Ecrã partido";
+        row.status = statuses[row.service_id];
+        for (size_t s = 0; s < SERVICE_STATUS_COUNT; s++) {
+            if (STATUS_TRANSITIONS[size_t(row.status)][s]) {
+                row.status = ServiceStatus(s);
+                break;
+            }
+        }
+        return row;
+    };
+    auto edit = [&](const ServiceRow &row) {
+        bool ok = edit_service(row, 1, db);
+        if (ok) statuses[row.service_id] = row.status;
+        return ok;
+    };
+    results.push_back(measure("edit_service", o.iterations, [&](size_t i) {
+        return size_t(edit(edited(i)));
+    }));
+    // the same edits committed EDIT_GROUP at a time, as the executor groups
+    // a burst of queued writes
+    constexpr size_t EDIT_GROUP = 64;
+    results.push_back(measure("edit_service_grouped", o.iterations, [&](size_t i) {
+        if (i % EDIT_GROUP == 0) execute_query("BEGIN IMMEDIATE;", db);
+        bool ok = edit(edited(o.iterations + i));
+        if (i % EDIT_GROUP == EDIT_GROUP - 1 || i + 1 == o.iterations) execute_query("COMMIT;", db);
+        return size_t(ok);
+    }));
+    // the services added above have no technician yet
+    results.push_back(measure("assign_technician", std::min(o.iterations, added.size()), [&](size_t i) {
+        int tech = data.technician_ids.empty() ? 1 : data.technician_ids[i % data.technician_ids.size()];
+        return size_t(assign_technician(tech, added[i]));
+    }));
+
+    printf("{\n");
+    printf("  \"sqlite\": %s,\n", json_string(sqlite3_libversion()).c_str());
+    printf("  \"dataset\": {\"users\": %zu, \"technicians\": %zu, \"services\": %zu, "
+           "\"assignments\": %zu, \"generate_seconds\": %.3f},\n",
+           data.usernames.size(), data.technician_ids.size(), data.services,
+           data.assignments, gen_seconds);
+    printf("  \"unindexed_scans\": [");
+    for (size_t i = 0; i < scans.size(); i++) {
+        printf("%s%s", i ? ", " : "", json_string(scans[i]).c_str());
+    }
+    printf("],\n");
+    printf("  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        double throughput = r.seconds > 0 ? r.ops / r.seconds : 0;
+        printf("    {\"op\": %s, \"ops\": %zu, \"seconds\": %.6f, \"ops_per_sec\": %.1f, "
+               "\"p50_us\": %.2f, \"p99_us\": %.2f, \"rows\": %zu, "
+               "\"allocs_per_call\": %.1f, \"allocs_per_row\": %.2f}%s\n",
+               json_string(r.op).c_str(), r.ops, r.seconds, throughput,
+               r.p50_us, r.p99_us, r.rows, r.allocs, r.rows ? r.allocs / r.rows : 0.0,
+               i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+
+    disconnect(db);
+    return scans.empty() ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+// Times the list-filter text matching over generated service rows and
+// prints one JSON document to stdout.
+//
+//   sgos_match_bench [--rows N] [--regex-rows N] [--iterations N] [--seed N]
+//                    [--parallel 0|1]
+//
+// Each needle is matched by:
+//   regex_per_row    the old filter: std::regex("(" + text + ")(.*)") built
+//                    and matched against every client name
+//   regex_once       the same pattern compiled once
+//   fold_find        fold_text() on every row, then std::string::find
+//   snapshot_find    std::string_view::find over the folded snapshot columns
+//   snapshot_simd    TextMatcher over the folded snapshot columns
+// The regex variants only look at client names and are case-sensitive
+// prefix matches; the others search name, phone and email.
+//
+// With --parallel 1 it instead times run_query(), the list filter and sort,
+// over all rows for every SortKey, once on the calling thread alone and
+// once on query_pool(), e.g. with --rows 1000000.
+#include "datagen.h"
+#include "../include/json.h"
+#include "../include/parallel_query.h"
+#include "../include/service_snapshot.h"
+#include "../include/text_match.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    size_t rows = 200000;
+    size_t regex_rows = 20000;      // regex_per_row is far too slow for all rows
+    size_t iterations = 5;
+    uint64_t seed = 42;
+    bool parallel = false;          // time run_query() instead of the matchers
+};
+
+struct Result {
+    std::string op;
+    std::string needle;
+    size_t rows = 0;
+    size_t matches = 0;
+    double ns_per_row = 0;          // best of the iterations
+};
+
+// Runs fn() iterations times over `rows` rows; fn returns the match count.
+template<class F>
+Result measure(const std::string &op, const std::string &needle, size_t rows, size_t iterations, F fn) {
+    Result r{op, needle, rows};
+    double best = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        auto t0 = Clock::now();
+        r.matches = fn();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        if (i == 0 || ns < best) best = ns;
+    }
+    r.ns_per_row = rows ? best / rows : 0;
+    return r;
+}
+
+bool parse_args(int argc, char *argv[], Options &o) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 == argc) return false;
+        const char *value = argv[++i];
+        if (arg == "--rows") o.rows = strtoull(value, nullptr, 10);
+        else if (arg == "--regex-rows") o.regex_rows = strtoull(value, nullptr, 10);
+        else if (arg == "--iterations") o.iterations = strtoull(value, nullptr, 10);
+        else if (arg == "--seed") o.seed = strtoull(value, nullptr, 10);
+        else if (arg == "--parallel") o.parallel = strtoul(value, nullptr, 10) != 0;
+        else return false;
+    }
+    return o.iterations > 0;
+}
+
+// Best-of-iterations milliseconds of run_query() over every row, for each
+// order and needle, on one thread and on the shared pool.
+int run_parallel(const Options &o, const ServiceSnapshot &snapshot) {
+    const std::pair<const char*, SortKey> keys[] = {
+        {"list_order", SortKey::ListOrder}, {"client", SortKey::Client}, {"status", SortKey::Status},
+        {"created", SortKey::Created}, {"technician", SortKey::Technician},
+    };
+    WorkerPool single(0);
+    WorkerPool &pool = query_pool();
+    printf("{\n");
+    printf("  \"rows\": %zu,\n", snapshot.size());
+    printf("  \"pool_threads\": %zu,\n", pool.size());
+    printf("  \"results\": [\n");
+    bool first = true;
+    for (const char *needle : {"", "silva"}) {
+        QueryMatcher match(ServiceQuery{needle, "all"});
+        for (const auto &[name, key] : keys) {
+            SortOrder order{key, false};
+            double ms[2];
+            size_t matches = 0;
+            WorkerPool *pools[2] = {&single, &pool};
+            for (int p = 0; p < 2; p++) {
+                for (size_t i = 0; i < o.iterations; i++) {
+                    auto t0 = Clock::now();
+                    matches = run_query(snapshot, match, order, 0, *pools[p]).size();
+                    double t = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+                    if (i == 0 || t < ms[p]) ms[p] = t;
+                }
+            }
+            printf("%s    {\"op\": \"run_query\", \"order\": %s, \"needle\": %s, \"matches\": %zu, "
+                   "\"ms_one_thread\": %.2f, \"ms_pool\": %.2f}",
+                   first ? "" : ",\n", json_string(name).c_str(), json_string(needle).c_str(),
+                   matches, ms[0], ms[1]);
+            first = false;
+        }
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    Options o;
+    if (!parse_args(argc, argv, o)) {
+        fprintf(stderr, "usage: %s [--rows N] [--regex-rows N] [--iterations N] [--seed N] "
+                        "[--parallel 0|1]\n", argv[0]);
+        return 2;
+    }
+    std::vector<ServiceSummary> rows = generate_rows(o.rows, o.seed);
+    ServiceSnapshot snapshot;
+    snapshot.reset(rows);
+    if (o.parallel) return run_parallel(o, snapshot);
+    size_t regex_rows = std::min(o.regex_rows, rows.size());
+
+    const std::vector<std::string> needles = {"Silva", "joao", "gonçalves", "9123", "cliente1234"};
+    std::vector<Result> results;
+    for (const auto &needle : needles) {
+        results.push_back(measure("regex_per_row", needle, regex_rows, 1, [&] {
+            size_t n = 0;
+            for (size_t i = 0; i < regex_rows; i++) {
+                std::regex pattern("(" + needle + ")(.*)");
+                n += std::regex_match(rows[i].client_name, pattern);
+            }
+            return n;
+        }));
+        results.push_back(measure("regex_once", needle, rows.size(), o.iterations, [&] {
+            std::regex pattern("(" + needle + ")(.*)");
+            size_t n = 0;
+            for (const auto &row : rows) n += std::regex_match(row.client_name, pattern);
+            return n;
+        }));
+        results.push_back(measure("fold_find", needle, rows.size(), o.iterations, [&] {
+            std::string folded = fold_text(needle);
+            size_t n = 0;
+            for (const auto &row : rows) {
+                n += fold_text(row.client_name).find(folded) != std::string::npos
+                  || fold_text(row.phone_number).find(folded) != std::string::npos
+                  || fold_text(row.email).find(folded) != std::string::npos;
+            }
+            return n;
+        }));
+        results.push_back(measure("snapshot_find", needle, rows.size(), o.iterations, [&] {
+            std::string folded = fold_text(needle);
+            size_t n = 0;
+            for (uint32_t i = 0; i < snapshot.size(); i++) {
+                n += snapshot.name_key(i).find(folded) != std::string_view::npos
+                  || snapshot.phone_key(i).find(folded) != std::string_view::npos
+                  || snapshot.email_key(i).find(folded) != std::string_view::npos;
+            }
+            return n;
+        }));
+        results.push_back(measure("snapshot_simd", needle, rows.size(), o.iterations, [&] {
+            TextMatcher matcher(needle);
+            size_t n = 0;
+            for (uint32_t i = 0; i < snapshot.size(); i++) {
+                n += matcher.contains_padded(snapshot.name_key(i))
+                  || matcher.contains_padded(snapshot.phone_key(i))
+                  || matcher.contains_padded(snapshot.email_key(i));
+            }
+            return n;
+        }));
+    }
+
+    printf("{\n");
+    printf("  \"rows\": %zu,\n", rows.size());
+    printf("  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        printf("    {\"op\": %s, \"needle\": %s, \"rows\": %zu, \"matches\": %zu, \"ns_per_row\": %.2f}%s\n",
+               json_string(r.op).c_str(), json_string(r.needle).c_str(), r.rows, r.matches,
+               r.ns_per_row, i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+    return 0;
+}
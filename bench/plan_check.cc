@@ -0,0 +1,32 @@
+// Seeds a database with a generated dataset and fails when a statement in
+// db.cc plans a full table scan; registered with ctest.
+//
+//   sgos_plan_check PATH
+#include "datagen.h"
+#include "../include/db.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s PATH\n", argv[0]);
+        return 2;
+    }
+    std::string path = argv[1];
+    for (const char *suffix : {"", "-wal", "-shm"}) remove((path + suffix).c_str());
+    DbConfig config;
+    config.trace = false;
+    if (!open_path(path, db, config)) return 2;
+    initDatabase(db);
+
+    DatasetSpec spec;
+    spec.users = 50;
+    spec.services = 2000;
+    generate_dataset(spec, db);
+
+    std::vector<std::string> scans = unindexed_scans(db);
+    for (const auto &scan : scans) fprintf(stderr, "full table scan: %s\n", scan.c_str());
+    disconnect(db);
+    return scans.empty() ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <sqlite3.h>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+enum class ChangeOp { Insert, Update, Delete };
+
+struct RowChange {
+    std::string table;
+    ChangeOp op;
+    sqlite3_int64 rowid;
+};
+
+// One committed transaction, with at most one entry per row: an insert
+// followed by updates is still an insert, insert then delete vanishes, and
+// delete then insert of the same rowid becomes an update.
+using ChangeSet = std::vector<RowChange>;
+
+// Row-level change feed for one connection, built on sqlite3_update_hook,
+// sqlite3_commit_hook and sqlite3_rollback_hook. Only the watched tables
+// are recorded.
+//
+// The hooks run on the thread that writes. Transactions that committed are
+// held until flush(), which the writer calls once COMMIT has returned, so
+// a listener that reads the rows back always sees the committed data.
+// flush() hands each ChangeSet to post, which the UI wires to its main
+// loop; listeners run there.
+class ChangeFeed {
+public:
+    using Listener = std::function<void(const ChangeSet&)>;
+    using Poster = std::function<void(std::function<void()>)>;
+
+    ChangeFeed(sqlite3 *db_, std::vector<std::string> tables_, Poster post_);
+    ~ChangeFeed();
+
+    ChangeFeed(const ChangeFeed&) = delete;
+    ChangeFeed& operator=(const ChangeFeed&) = delete;
+
+    // Writer thread.
+    void flush();
+
+    // Listener thread; returns a handle for unsubscribe().
+    size_t subscribe(Listener listener);
+    void unsubscribe(size_t handle);
+
+private:
+    static void on_update(void *self, int op, const char *db_name, const char *table, sqlite3_int64 rowid);
+    static int on_commit(void *self);
+    static void on_rollback(void *self);
+
+    void record(int table, ChangeOp op, sqlite3_int64 rowid);
+    void publish(const ChangeSet &changes);
+
+    sqlite3 *db;
+    std::vector<std::string> tables;
+    Poster post;
+
+    // writer thread only
+    struct Pending {
+        int table;
+        ChangeOp op;
+        sqlite3_int64 rowid;
+        bool dropped;
+    };
+    std::vector<Pending> pending;
+    std::map<std::pair<int, sqlite3_int64>, size_t> pending_index;
+
+    std::mutex mutex;               // guards committed
+    std::vector<ChangeSet> committed;
+
+    std::unordered_map<size_t, Listener> listeners;
+    size_t next_handle = 1;
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <sqlite3.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "db.h"
+
+// Fixed set of connections to one database file. In WAL mode readers never
+// block the writer, so list and search queries can run on these while
+// edits go through the main connection.
+class ConnectionPool {
+public:
+    ConnectionPool(const std::string &path, size_t size, const DbConfig &config);
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Borrowed connection; goes back to the pool when the lease is destroyed.
+    class Lease {
+    public:
+        Lease(ConnectionPool &pool_, sqlite3 *db_) : pool(&pool_), db(db_) {}
+        Lease(Lease &&other) noexcept : pool(other.pool), db(other.db) { other.db = nullptr; }
+        ~Lease() { if (db) pool->release(db); }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+
+        sqlite3 *get() const { return db; }
+    private:
+        ConnectionPool *pool;
+        sqlite3 *db;
+    };
+
+    // Blocks until a connection is free.
+    Lease acquire();
+    size_t size() const { return all.size(); }
+
+private:
+    void release(sqlite3 *db);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<sqlite3*> all;
+    std::vector<sqlite3*> idle;
+};
@@ -0,0 +1,287 @@
+#pragma once
+// Data layer: row types and the SQLite functions behind them. Nothing here
+// depends on GTK, so the sgos_db library and the benchmark build without it.
+#include <sqlite3.h>
+
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "service_status.h"
+
+extern sqlite3* db;
+
+struct LoginResult {
+    int user_id;
+    std::string full_name;
+    int role_id;
+};
+
+struct MessageObject {
+    int id;
+    std::string sender;
+    std::string receiver;
+    std::string message;
+    time_t timestamp;
+};
+
+struct UserRow {
+    int user_id;
+    std::string username;
+    std::string full_name;
+    std::string email;
+    int role_id;
+};
+
+// The columns the service lists show, filter and sort on. The free-text
+// equipment and problem report are left out: a list never shows them, and
+// reading them is most of the cost of a row.
+struct ServiceSummary {
+    int service_id = 0;
+    std::string client_name;
+    std::string phone_number;
+    std::string email;
+    ServiceStatus status = ServiceStatus::Open;
+    sqlite3_int64 created_at = 0;   // unix time
+    int technician_id = 0;      // lowest assigned technician id, 0 if none
+};
+
+// Every column of a service, as the edit dialog needs it.
+struct ServiceRow : ServiceSummary {
+    std::string equipment;
+    std::string problem_report;
+    int created_by_id = 0;
+    // unix time of the move to a closed status, see is_closed(); empty
+    // while open
+    std::optional<sqlite3_int64> closed_at;
+};
+
+// Position in the services list, ordered by (created_at, service_id) DESC.
+struct ServiceCursor {
+    sqlite3_int64 created_at;
+    int service_id;
+};
+
+// Unix times from `from` up to, not including, `to`. The default is every
+// time.
+struct TimeRange {
+    sqlite3_int64 from = std::numeric_limits<sqlite3_int64>::min();
+    sqlite3_int64 to = std::numeric_limits<sqlite3_int64>::max();
+
+    bool contains(sqlite3_int64 t) const { return t >= from && t < to; }
+    bool operator==(const TimeRange &other) const = default;
+};
+
+struct ServicePage {
+    std::vector<ServiceSummary> rows;
+    std::optional<ServiceCursor> next;   // empty on the last page
+};
+
+// The services assigned to one technician, by status.
+struct TechnicianLoad {
+    int technician_id = 0;      // 0 for the services nobody is assigned to
+    std::string full_name;
+    std::array<int, SERVICE_STATUS_COUNT> by_status{};
+};
+
+// What the dashboard shows, indexed by ServiceStatus.
+struct ServiceCounts {
+    std::array<int, SERVICE_STATUS_COUNT> by_status{};
+    std::array<int, SERVICE_STATUS_COUNT> recent{};   // created in the last few days
+    std::vector<TechnicianLoad> technicians;        // by technician_id, 0 first
+};
+
+// One column of a service whose value an edit changed, named as in the
+// services table.
+struct FieldChange {
+    std::string field;
+    std::string old_value;
+    std::string new_value;
+};
+
+struct LogRow {
+    int change_id;
+    int service_id;
+    int user_id;
+    std::string field;
+    std::string old_value;
+    std::string new_value;
+    std::string created_at;
+};
+
+// One entry of a service's timeline (service_history): a note, a status the
+// service moved to, or both.
+struct TimelineEntry {
+    int history_id = 0;
+    int service_id = 0;
+    int user_id = 0;            // 0 when not recorded
+    std::string user_name;
+    std::string note;
+    std::optional<ServiceStatus> status;   // empty when the status did not change
+    std::string created_at;
+};
+
+// Position in a timeline, ordered by (created_at, history_id) DESC.
+struct TimelineCursor {
+    std::string created_at;
+    int history_id;
+};
+
+struct TimelinePage {
+    std::vector<TimelineEntry> entries;
+    std::optional<TimelineCursor> next;   // empty on the last page
+};
+
+// Per-connection settings applied by connect(). journal_mode is
+// persistent in the file, so read-only connections skip it.
+struct DbConfig {
+    bool read_only = false;
+    std::string journal_mode = "WAL";
+    std::string synchronous = "NORMAL";
+    sqlite3_int64 mmap_size = 256LL * 1024 * 1024;
+    int cache_size_kib = 16 * 1024;
+    int busy_timeout_ms = 5000;
+    bool trace = true;          // record statement latencies, see query_trace.h
+};
+
+// Unix time of "YYYY-MM-DD", "YYYY-MM-DD hh:mm:ss" or "YYYY-MM-DDThh:mm:ss"
+// read as UTC, the form CURRENT_TIMESTAMP writes, or of a plain number of
+// seconds. Empty if text is none of these.
+std::optional<sqlite3_int64> parse_utc_time(std::string_view text);
+
+std::string db_path(const std::string &name);
+bool connect(std::string username_, sqlite3 *&db, const DbConfig &config = DbConfig{});
+bool open_path(const std::string &path, sqlite3 *&db, const DbConfig &config);
+void disconnect(sqlite3 *&db);
+
+void execute_query(const std::string &query, sqlite3 *db);
+
+// Migrates the schema to the latest version and repairs a search index or
+// counts left suspended. On a current database this costs one pragma read.
+void initDatabase(sqlite3 *db);
+// Bits of PRAGMA user_version above the schema version. A suspend_* call
+// below sets its bit and the matching init_* clears it, so a bulk load that
+// died half way shows in the same read that finds the schema current.
+constexpr int SEARCH_INDEX_SUSPENDED = 1 << 30;
+constexpr int SERVICE_COUNTS_SUSPENDED = 1 << 29;
+constexpr int SCHEMA_FLAGS = SEARCH_INDEX_SUSPENDED | SERVICE_COUNTS_SUSPENDED;
+// PRAGMA user_version without the flags, or -1 if it cannot be read.
+int schema_version(sqlite3 *db);
+int latest_schema_version();
+bool set_schema_flag(sqlite3 *db, int flag, bool on);
+// Applies, in order, each migration in migrations.cc newer than the
+// database; each runs once, in its own transaction. Then repairs whatever
+// the flags say a bulk load left suspended. False if a step fails or the
+// database is newer than this build.
+bool migrate(sqlite3 *db);
+void init_search_index(sqlite3 *db);
+// Stops indexing new services one row at a time, for bulk loads. The next
+// init_search_index() call rebuilds the index and restores the trigger; a
+// load that dies half way leaves SEARCH_INDEX_SUSPENDED set, and the next
+// start repairs it.
+void suspend_search_index(sqlite3 *db);
+// Same for the counts behind get_service_counts(): stops counting new
+// services and assignments, and the next init_service_counts() counts every
+// service again and restores the triggers. False if that fails.
+void suspend_service_counts(sqlite3 *db);
+bool init_service_counts(sqlite3 *db);
+// Runs the step of that version again, outside migrate() and without
+// touching user_version, for repairs that need the DDL as it shipped.
+bool replay_migration(sqlite3 *db, int version);
+// False when SQLite was built without FTS5.
+bool search_available(sqlite3 *db);
+// Runs EXPLAIN QUERY PLAN over every statement in db.cc and returns one
+// "sql -> plan" line for each full table scan. Empty means all indexed.
+std::vector<std::string> unindexed_scans(sqlite3 *db);
+
+bool user_exists(const std::string &username, sqlite3 *db);
+    
+bool add_user(const std::string &full_name,
+    const std::string &email,
+    const std::string &username,
+    const std::string &access_code_hash,
+    const int &role_id, sqlite3 *db);
+
+std::optional<UserRow> get_user_by_id(int user_id, sqlite3 *db);
+std::optional<LoginResult> try_login(const std::string& username, const std::string& access_code);
+bool edit_user(int user_id,
+               const std::string &full_name,
+               const std::string &email,
+               const std::string &username,
+               int role_id,
+               sqlite3 *db);
+bool delete_user(int user_id, sqlite3 *db);
+std::vector<UserRow> get_users(sqlite3 *db);
+// The list functions below return summaries; get_service_by_id() reads
+// the whole row.
+std::vector<ServiceSummary> get_services(sqlite3 *db, int only_assigned_to);
+std::optional<ServiceRow> get_service_by_id(int service_id, sqlite3 *db);
+std::optional<ServiceSummary> get_service_summary(int service_id, sqlite3 *db);
+// Number of services in each status, indexed by ServiceStatus. Like
+// get_service_counts() it reads the counts triggers keep, not services.
+std::array<int, SERVICE_STATUS_COUNT> count_services_by_status(sqlite3 *db);
+// Counts by status overall, among the services created on the last
+// recent_days UTC days (today included), and per technician. A service with
+// several technicians counts for each.
+ServiceCounts get_service_counts(int recent_days, sqlite3 *db);
+// One page of the list, restricted to services created within `created`;
+// the range and the order are both read from idx_services_created.
+ServicePage get_services_page(sqlite3 *db, int only_assigned_to,
+                              const std::optional<ServiceCursor> &after,
+                              int page_size, const TimeRange &created = TimeRange{});
+// Streams rows newest first; fn returns false to stop early.
+void for_each_service(sqlite3 *db, int only_assigned_to,
+                      const std::function<bool(const ServiceSummary&)> &fn);
+// Ranked full-text search over client name, phone, email, equipment and
+// problem report, among the services created within `created`. Every word
+// is matched as a prefix.
+std::vector<ServiceSummary> search_services(const std::string &query, int limit,
+                                            const TimeRange &created, sqlite3 *db);
+bool add_service(const std::string& client_name,
+                 const std::string& client_phone,
+                 const std::string& client_email,
+                 const std::string& equipment_desc,
+                 const std::string& problem_report,
+                 int created_by_user_id,
+                 sqlite3 *db);
+// Saves the editable fields of row and writes one change_logs row per field
+// that changed, attributed to edited_by_id, in the same transaction as the
+// UPDATE; a status change is also appended to the timeline and sets or
+// clears closed_at. An edit that
+// changes nothing writes nothing, and one whose status change
+// can_transition() forbids fails without writing.
+bool edit_service(const ServiceRow &row, int edited_by_id, sqlite3 *db);
+// Deletes the service together with its change_logs and timeline.
+bool delete_service(int service_id, sqlite3 *db);
+
+// The editable fields that differ between before and after.
+std::vector<FieldChange> diff_service(const ServiceRow &before, const ServiceRow &after);
+// Inserts one change_logs row per change through a single statement; a
+// user_id of 0 is stored as NULL.
+bool add_change_logs(int service_id, int user_id, const std::string &change_type,
+                     const std::vector<FieldChange> &changes, sqlite3 *db);
+
+// Appends to a service's timeline; an empty note or status is stored as
+// NULL, and so is a user_id of 0.
+bool add_timeline_entry(int service_id, int user_id, const std::string &note,
+                        std::optional<ServiceStatus> status, sqlite3 *db);
+// A service's timeline newest first, page_size entries at a time, walking
+// the (service_id, created_at) index without a sort.
+TimelinePage get_timeline_page(int service_id, const std::optional<TimelineCursor> &after,
+                               int page_size, sqlite3 *db);
+// One entry by history_id, e.g. a row the change feed reported.
+std::optional<TimelineEntry> get_timeline_entry(int history_id, sqlite3 *db);
+
+bool assign_technician(int technician_id, int service_id);
+// (service_id, technician_id) of a service_technicians row.
+std::optional<std::pair<int, int>> get_assignment(sqlite3_int64 rowid, sqlite3 *db);
+
+std::optional<UserRow> get_user_by_name(std::string full_name, sqlite3 *db);
+
@@ -0,0 +1,111 @@
+#pragma once
+#include <sqlite3.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ChangeFeed;
+class ConnectionPool;
+
+// Owns the write connection on a dedicated thread. Callers queue jobs that
+// receive a connection; results come back either through a std::future or
+// through a completion callback that is handed to post_to_ui, which the UI
+// wires to its main loop.
+//
+// Write jobs that are queued back to back run inside a single transaction,
+// so a burst of edits costs one commit instead of one per statement. Their
+// completions are only posted once that transaction has committed. If it
+// fails to commit, it is rolled back and each of its jobs runs again in a
+// transaction of its own, so a write job may run twice and must not have
+// effects outside the database.
+//
+// With a ConnectionPool, read jobs run on one thread per pooled connection
+// in parallel with the writer; without one they share the writer's queue.
+//
+// An attached ChangeFeed is flushed after every commit on the writer, before
+// the completions of the jobs that made the changes are posted.
+class DbExecutor {
+public:
+    using Completion = std::function<void()>;
+    using Job = std::function<Completion(sqlite3*)>;
+    using Poster = std::function<void(Completion)>;
+
+    DbExecutor(sqlite3 *db_, Poster post_to_ui_, ConnectionPool *readers_ = nullptr);
+    ~DbExecutor();
+
+    DbExecutor(const DbExecutor&) = delete;
+    DbExecutor& operator=(const DbExecutor&) = delete;
+
+    // The feed must be installed on the writer connection and outlive the
+    // executor; attach it before queuing writes.
+    void attach(ChangeFeed *feed_);
+
+    // Runs fn(db) on the writer and done(result) on the UI thread.
+    template<class F, class Done>
+    void run(F fn, Done done) { enqueue(Kind::Plain, wrap(std::move(fn), std::move(done))); }
+
+    template<class F, class Done>
+    void run_write(F fn, Done done) { enqueue(Kind::Write, wrap(std::move(fn), std::move(done))); }
+
+    // fn must only read; it may run on a pooled read-only connection.
+    template<class F, class Done>
+    void run_read(F fn, Done done) { enqueue(Kind::Read, wrap(std::move(fn), std::move(done))); }
+
+    // Runs fn(db) on the writer; the result is delivered through the future.
+    template<class F>
+    auto submit(F fn) -> std::future<std::invoke_result_t<F, sqlite3*>> {
+        using R = std::invoke_result_t<F, sqlite3*>;
+        auto task = std::make_shared<std::packaged_task<R(sqlite3*)>>(std::move(fn));
+        auto future = task->get_future();
+        enqueue(Kind::Plain, [task](sqlite3 *db) { (*task)(db); return Completion(); });
+        return future;
+    }
+
+private:
+    enum class Kind { Plain, Write, Read };
+
+    struct Task {
+        bool write;
+        Job job;
+    };
+
+    template<class F, class Done>
+    Job wrap(F fn, Done done) {
+        using R = std::invoke_result_t<F, sqlite3*>;
+        return [fn = std::move(fn), done = std::move(done)](sqlite3 *db) mutable -> Completion {
+            if constexpr (std::is_void_v<R>) {
+                fn(db);
+                return done;
+            } else {
+                auto result = std::make_shared<R>(fn(db));
+                return [done, result]() mutable { done(std::move(*result)); };
+            }
+        };
+    }
+
+    void enqueue(Kind kind, Job job);
+    void writer_loop();
+    void reader_loop();
+    void post(Completion completion);
+    void flush_changes();
+
+    sqlite3 *db;
+    Poster post_to_ui;
+    ConnectionPool *readers;
+    ChangeFeed *feed = nullptr;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::condition_variable read_cv;
+    std::deque<Task> queue;
+    std::deque<Job> read_queue;
+    bool stopping = false;
+    std::thread writer;
+    std::vector<std::thread> reader_threads;
+};
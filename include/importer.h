@@ -0,0 +1,41 @@
+#pragma once
+#include <sqlite3.h>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+enum class ImportKind { Services, Users };
+
+struct ImportProgress {
+    size_t read = 0;        // records parsed, good or bad
+    size_t imported = 0;    // committed
+    size_t rejected = 0;
+    std::string error;      // why the import stopped early; empty if it finished
+};
+
+struct ImportOptions {
+    size_t batch_size = 50000;      // records per transaction
+    std::string reject_path;        // rejected records are written here; empty discards them
+    int default_created_by = 1;     // services without a created_by_id column
+    // Index imported services for search once at the end instead of per row.
+    // Per-row indexing costs several times the insert itself.
+    bool defer_search_index = true;
+    // Likewise recount the service counts once at the end instead of
+    // running their triggers per row.
+    bool defer_service_counts = true;
+    std::function<void(const ImportProgress&)> on_progress;   // after every committed batch
+};
+
+// Streams a .csv file (first row is the header) or a .jsonl file (one flat
+// object per line) into services or users. Column names match the table
+// columns; users may give a role name in "role" instead of "role_id".
+// Service dates are read by parse_utc_time().
+//
+// Records are validated, then inserted through one prepared statement inside
+// transactions of batch_size rows. A record that fails validation or a
+// constraint is written to reject_path with the reason and does not stop the
+// import. A batch whose COMMIT fails is rolled back and ends the import;
+// its records are not counted, and error says from which line on the input
+// is missing.
+ImportProgress import_file(ImportKind kind, const std::string &path,
+                           const ImportOptions &options, sqlite3 *db);
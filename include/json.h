@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdio>
+#include <string>
+
+// JSON string literal for s, for the benchmark reports and the trace dump.
+inline std::string json_string(const std::string &s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += char(c);
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof buf, "\\u%04x", c);
+            out += buf;
+        } else {
+            out += char(c);
+        }
+    }
+    return out + '"';
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "service_filter.h"
+#include "service_snapshot.h"
+
+// Fixed set of threads for fork-join work. run() splits a job into tasks,
+// works on them from the calling thread too, and returns when all are done,
+// so results are back on the caller (the UI thread for the lists).
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Threads that take part in run(), counting the caller.
+    size_t size() const { return threads.size() + 1; }
+
+    // Calls fn(i) for every i in [0, tasks). One run() at a time.
+    void run(size_t tasks, const std::function<void(size_t)> &fn);
+
+private:
+    void worker_loop();
+    bool claim(size_t &task);   // with mutex held
+
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    const std::function<void(size_t)> *job = nullptr;
+    size_t next_task = 0;
+    size_t total = 0;
+    size_t finished = 0;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
+
+// Shared pool for the list queries: one thread per core, less the caller.
+WorkerPool &query_pool();
+
+// The parallel scans below split the rows into partitions for the pool;
+// inputs smaller than a partition run on the calling thread alone.
+
+// Indices in [first, rows.size()) that match, ascending.
+std::vector<uint32_t> select_rows(const ServiceSnapshot &rows, const QueryMatcher &match,
+                                  size_t first, WorkerPool &pool);
+// The candidates that match, in their original order.
+std::vector<uint32_t> select_rows(const ServiceSnapshot &rows, const QueryMatcher &match,
+                                  const std::vector<uint32_t> &candidates, WorkerPool &pool);
+// Sorts indices into order: every partition builds its sort keys and sorts
+// them, then the sorted runs are merged pairwise.
+void sort_rows(const ServiceSnapshot &rows, const SortOrder &order,
+               std::vector<uint32_t> &indices, WorkerPool &pool);
+// Matching indices in [first, rows.size()), sorted into order, with the
+// filter, key building and local sort done per partition in one pass.
+std::vector<uint32_t> run_query(const ServiceSnapshot &rows, const QueryMatcher &match,
+                                const SortOrder &order, size_t first, WorkerPool &pool);
+
+// Whether rows[a] comes before rows[b] in order.
+bool row_before(const ServiceSnapshot &rows, const SortOrder &order, uint32_t a, uint32_t b);
@@ -0,0 +1,56 @@
+#pragma once
+#include <sqlite3.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Latency tracing for the data layer. Two kinds of entries are kept:
+// statements, recorded by a sqlite3_trace_v2 hook under their SQL text, and
+// calls, recorded by a TraceScope around each db.cc entry point. Every
+// thread records into a table of its own with plain relaxed stores, so
+// recording never locks or contends; trace_snapshot() sums the tables of all
+// threads that have recorded.
+
+// Records each statement db runs: the time from SQLITE_TRACE_STMT to
+// SQLITE_TRACE_PROFILE and the rows counted by SQLITE_TRACE_ROW. open_path()
+// installs it unless DbConfig::trace is off.
+void trace_statements(sqlite3 *db);
+
+// Times one call, from construction to destruction, under name, which must
+// stay valid for the life of the process (a string literal).
+class TraceScope {
+public:
+    explicit TraceScope(const char *name_);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    // Rows the call returned.
+    void rows(size_t n) { row_count = n; }
+
+private:
+    const char *name;
+    int64_t start_ns;
+    size_t row_count = 0;
+};
+
+struct TraceStats {
+    std::string name;       // entry point, or SQL text for a statement
+    bool statement = false;
+    uint64_t count = 0;
+    uint64_t rows = 0;
+    double total_ms = 0;
+    double p50_us = 0;
+    double p95_us = 0;
+    double p99_us = 0;
+    double max_us = 0;
+};
+
+// Everything recorded so far, largest total time first. The percentiles
+// come from log-linear buckets and are within 1/16 of the true value.
+std::vector<TraceStats> trace_snapshot();
+// trace_snapshot() as one JSON document, calls and statements apart.
+std::string trace_json();
+// Writes trace_json() to path; false, with a message on stderr, on failure.
+bool dump_trace(const std::string &path);
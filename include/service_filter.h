@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "db.h"
+#include "service_snapshot.h"
+#include "text_match.h"
+
+// A list filter: text that must appear in the client name, phone or email,
+// ignoring case and accents, plus a status, where "all" (or an empty status)
+// accepts every status. The text is taken literally.
+struct ServiceQuery {
+    std::string text;
+    std::string status = "all";
+
+    bool matches(const ServiceSnapshot &rows, uint32_t index) const;
+    // True when every row matching *this also matches prev, so the new
+    // result can be computed by narrowing the previous one.
+    bool narrows(const ServiceQuery &prev) const;
+    bool operator==(const ServiceQuery &other) const = default;
+};
+
+// A ServiceQuery reduced to what the column scans compare. It is only read
+// while matching, so one instance can be shared by several threads.
+class QueryMatcher {
+public:
+    explicit QueryMatcher(const ServiceQuery &query);
+
+    bool operator()(const ServiceSnapshot &rows, uint32_t index) const {
+        if (!any_status && rows.status(index) != want) return false;
+        return text.empty() || text.contains_padded(rows.name_key(index))
+            || text.contains_padded(rows.phone_key(index)) || text.contains_padded(rows.email_key(index));
+    }
+
+private:
+    bool any_status;
+    ServiceStatus want;
+    TextMatcher text;
+};
+
+// Order of a list's visible rows. ListOrder is the order the rows were
+// loaded in (newest first); the others sort on one column and fall back to
+// list order for ties. Client sorts by folded name, Status in lifecycle
+// order, Technician by id with unassigned rows last.
+enum class SortKey { ListOrder, Client, Status, Created, Technician };
+
+struct SortOrder {
+    SortKey key = SortKey::ListOrder;
+    bool descending = false;   // ignored for ListOrder
+
+    bool operator==(const SortOrder &other) const = default;
+};
+
+// One contiguous edit of the match list: at `position`, `removed` entries
+// were replaced by `added` entries.
+struct FilterChange {
+    uint32_t position;
+    uint32_t removed;
+    uint32_t added;
+};
+
+// Keeps the indices of the rows that pass the current query, in the current
+// sort order, and turns changes into list edits. Rows are read from a
+// ServiceSnapshot, so the scans only touch the columns they compare; large
+// scans and sorts are split across query_pool().
+//
+// In list order, query changes become the minimal set of edits. In any
+// other order a new query or order replaces the whole list, while the
+// single-row edits still move just that row.
+class ServiceFilter {
+public:
+    // Recomputes from scratch, e.g. after the underlying rows were replaced.
+    void reset(const ServiceSnapshot &rows);
+    // Filters rows[first..] that were appended to the end. In list order the
+    // matches are appended and reported as one edit; in any other order they
+    // are merged in and reported as a replacement of the whole list.
+    void extend(const ServiceSnapshot &rows, size_t first,
+                const std::function<void(const FilterChange&)> &on_change);
+    // Switches to a new query. on_change is called once per contiguous edit,
+    // from the back of the list to the front, after matches() already
+    // reflects that edit, so it can be forwarded to items_changed directly.
+    void update(const ServiceSnapshot &rows, const ServiceQuery &next,
+                const std::function<void(const FilterChange&)> &on_change);
+    // Re-sorts the current matches.
+    void set_order(const ServiceSnapshot &rows, const SortOrder &next,
+                   const std::function<void(const FilterChange&)> &on_change);
+
+    // Single-row edits, each reported through on_change like update():
+    // rows[index] was replaced in place and is tested again,
+    void refresh(const ServiceSnapshot &rows, uint32_t index,
+                 const std::function<void(const FilterChange&)> &on_change);
+    // rows[index] was inserted, so later indices move up by one,
+    void insert(const ServiceSnapshot &rows, uint32_t index,
+                const std::function<void(const FilterChange&)> &on_change);
+    // or rows[index] was erased and later indices move down by one.
+    void erase(uint32_t index, const std::function<void(const FilterChange&)> &on_change);
+
+    void set_query(const ServiceQuery &q) { query = q; }
+    const ServiceQuery &current() const { return query; }
+    const SortOrder &current_order() const { return order; }
+    const std::vector<uint32_t> &matches() const { return matched; }
+
+private:
+    bool list_order() const { return order.key == SortKey::ListOrder; }
+    // Position in matched where rows[index] belongs.
+    uint32_t position_for(const ServiceSnapshot &rows, uint32_t index) const;
+    void replace_all(std::vector<uint32_t> result,
+                     const std::function<void(const FilterChange&)> &on_change);
+
+    ServiceQuery query;
+    SortOrder order;
+    std::vector<uint32_t> matched;
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include <gtkmm.h>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "main.h"
+#include "service_filter.h"
+#include "db_executor.h"
+#include "service_repository.h"
+
+// GObject wrapper handed to the ListView for one visible row.
+class ServiceItem : public Glib::Object {
+public:
+    static Glib::RefPtr<ServiceItem> create(const ServiceSummary &row);
+    ServiceSummary row;
+protected:
+    explicit ServiceItem(const ServiceSummary &row_);
+};
+
+// List model over plain ServiceSummary data. Rows only become ServiceItems when
+// the ListView asks for them, i.e. for the rows that are actually on screen.
+class ServiceListModel : public Gio::ListModel, public Glib::Object {
+public:
+    static Glib::RefPtr<ServiceListModel> create();
+
+    void set_rows(std::vector<ServiceSummary> rows_);
+    void append_rows(const std::vector<ServiceSummary> &more);
+    // Announces only the rows that appear or disappear.
+    void set_query(const ServiceQuery &query);
+    // Re-sorts the loaded rows; rows loaded later are merged into the order.
+    void set_order(const SortOrder &order);
+    // Patch one row by id. update_row returns false when the row is not
+    // loaded; insert_row places it in list order (newest first), or updates
+    // it in place if it is.
+    bool update_row(const ServiceSummary &row);
+    void insert_row(const ServiceSummary &row);
+    void remove_row(int service_id);
+    // Whether row sorts after every loaded row, i.e. into pages not yet loaded.
+    bool past_end(const ServiceSummary &row) const;
+    bool contains(int service_id) const { return position_of.count(service_id) != 0; }
+
+    const ServiceSummary *row_at(guint position) const;
+    const std::vector<ServiceSummary> &all_rows() const { return rows; }
+
+protected:
+    ServiceListModel();
+
+    GType get_item_type_vfunc() override;
+    guint get_n_items_vfunc() override;
+    gpointer get_item_vfunc(guint position) override;
+
+private:
+    void reindex(size_t first);
+    void forward(const FilterChange &change) { items_changed(change.position, change.removed, change.added); }
+
+    std::vector<ServiceSummary> rows;
+    ServiceSnapshot columns;   // mirrors rows; what the filter scans
+    std::unordered_map<int, uint32_t> position_of;   // service_id -> index in rows
+    ServiceFilter filter;   // its matches() are the visible rows
+};
+
+// Base for the widgets a ServiceListView recycles; bind() is called every
+// time the widget is reused for another row.
+class ServiceRowBase : public Gtk::Box {
+public:
+    ServiceRowBase();
+    virtual void bind(const ServiceSummary &s);
+
+    ServiceSummary service;
+protected:
+    Gtk::Label label;
+};
+
+// Scrollable, virtualized list of services that loads pages on demand as
+// the user scrolls to the bottom.
+class ServiceListView : public Gtk::ScrolledWindow {
+public:
+    explicit ServiceListView(std::function<ServiceRowBase*()> create_row);
+    ~ServiceListView() override;
+
+    // Loaded rows are cached in the repository, and its changes are
+    // applied to this list as they are committed.
+    void set_repository(ServiceRepository *repository_);
+
+    // Queries run on the executor; results that arrive after a newer
+    // load or search was started are dropped. Only services created within
+    // `created` are listed or found.
+    void load(DbExecutor *executor_, int only_assigned_to, const TimeRange &created_ = TimeRange{});
+    void load_more();
+    // Lists the services created within `created_` instead, keeping the
+    // current filter.
+    void set_created_range(const TimeRange &created_);
+    // Filters the loaded rows by client name, phone or email, ignoring case
+    // and accents, narrowing the previous result where it can. While pages
+    // remain unloaded and the full-text index exists, the text is also
+    // searched there, and the rows found are added to the list and filtered
+    // the same way; paging stops until the text is cleared. The index
+    // matches word prefixes, so a match inside a word is only found among
+    // the loaded rows.
+    void set_filter(const std::string &text, const std::string &status);
+    // Same, once typing has paused for a moment.
+    void set_filter_debounced(const std::string &text, const std::string &status);
+
+    Glib::RefPtr<ServiceListModel> model;
+
+private:
+    void on_repository_change(ServiceRepository::Change change, const ServiceSummary &row);
+    void show_row(const ServiceSummary &row);
+    void search(const std::string &text);
+
+    Gtk::ListView list;
+    DbExecutor *executor = nullptr;
+    ServiceRepository *repository = nullptr;
+    size_t subscription = 0;
+    int assigned_to = 0;
+    TimeRange created;
+    std::optional<ServiceCursor> next;
+    std::string filter_text;
+    std::string search_text;    // text whose search results were added, if any
+    bool fts = false;
+    bool loading = false;
+    unsigned generation = 0;
+    sigc::connection pending_query;
+};
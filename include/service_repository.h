@@ -0,0 +1,79 @@
+#pragma once
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "change_feed.h"
+#include "db.h"
+#include "db_executor.h"
+
+// Summaries of the services the UI has seen so far, indexed by id, by status
+// and by technician. Lookups come from memory. Writes go through the executor to
+// SQLite; the change feed then reports which rows they touched, and only
+// those rows are read back, cached and passed to the listeners, so an open
+// list can patch the one row that changed instead of reloading. Changes
+// made by any writer on the feed's connection arrive the same way.
+//
+// Only the UI thread may touch a repository; the executor and the feed post
+// there.
+class ServiceRepository {
+public:
+    enum class Change { Added, Updated, Removed };
+    using Listener = std::function<void(Change, const ServiceSummary&)>;
+
+    ServiceRepository(DbExecutor &executor_, ChangeFeed &feed_);
+    ~ServiceRepository();
+
+    ServiceRepository(const ServiceRepository&) = delete;
+    ServiceRepository& operator=(const ServiceRepository&) = delete;
+
+    // Caches rows read elsewhere, e.g. a list page. A non-zero technician_id
+    // records that the rows are assigned to that technician.
+    void remember(const std::vector<ServiceSummary> &rows, int technician_id = 0);
+
+    const ServiceSummary *find(int service_id) const;
+    // Cached ids only; the table may hold more.
+    std::vector<int> with_status(ServiceStatus status) const;
+    std::vector<int> assigned_to(int technician_id) const;
+
+    // Reads the whole row, for editing; the cache only holds summaries.
+    void get(int service_id, std::function<void(std::optional<ServiceRow>)> done);
+
+    // done(ok) runs once the write has committed; the listeners hear about
+    // it shortly after, when the changed rows have been read back. update()
+    // records the changed fields in change_logs with the edit; edits queued
+    // in a burst share the executor's group commit.
+    void add(const ServiceRow &row, int created_by_id, std::function<void(bool)> done);
+    void update(const ServiceRow &row, int edited_by_id, std::function<void(bool)> done);
+    void remove(int service_id, std::function<void(bool)> done);
+    void assign(int service_id, int technician_id, std::function<void(bool)> done);
+
+    // Returns a handle for unsubscribe().
+    size_t subscribe(Listener listener);
+    void unsubscribe(size_t handle);
+
+private:
+    void apply(const ChangeSet &changes);
+    void store(const ServiceSummary &row);
+    void forget(int service_id);
+    void forget_technician(int technician_id);
+    void notify(Change change, const ServiceSummary &row);
+
+    DbExecutor &executor;
+    ChangeFeed &feed;
+    size_t subscription;
+    // Rows touched by each change set are read back asynchronously; a read
+    // is dropped if a newer change set touched the same row meanwhile. With
+    // no read in flight nothing can be stale, so last_change is emptied.
+    unsigned generation = 0;
+    unsigned reads_in_flight = 0;
+    std::unordered_map<int, unsigned> last_change;   // service_id -> generation
+    std::unordered_map<int, ServiceSummary> by_id;
+    std::unordered_set<int> by_status[SERVICE_STATUS_COUNT + 1];   // indexed by ServiceStatus
+    std::unordered_map<int, std::unordered_set<int>> by_technician;
+    std::unordered_map<int, std::unordered_set<int>> technicians_of;   // reverse of by_technician
+    std::unordered_map<size_t, Listener> listeners;
+    size_t next_handle = 1;
+};
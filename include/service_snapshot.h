@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "db.h"
+
+// Strings packed end to end in one buffer, addressed by offset and length.
+// Erasing leaves the bytes behind; compact() drops them. The buffer always
+// ends with PADDING spare bytes, so every string can go to
+// TextMatcher::contains_padded().
+class StringColumn {
+public:
+    static constexpr size_t PADDING = 32;
+
+    void clear();
+    void reserve(size_t rows, size_t bytes);
+    void push_back(std::string_view s);
+    void insert(uint32_t index, std::string_view s);
+    void assign(uint32_t index, std::string_view s);
+    void erase(uint32_t index);
+    void compact();
+
+    size_t size() const { return offset.size(); }
+    size_t bytes() const { return arena.size() - PADDING; }
+    size_t memory_used() const {
+        return arena.capacity() + (offset.capacity() + length.capacity()) * sizeof(uint32_t);
+    }
+    std::string_view operator[](uint32_t index) const {
+        return std::string_view(arena.data() + offset[index], length[index]);
+    }
+
+private:
+    uint32_t store(std::string_view s);
+
+    std::string arena = std::string(PADDING, '\0');
+    std::vector<uint32_t> offset;
+    std::vector<uint32_t> length;
+    size_t garbage = 0;
+};
+
+// Read-optimized copy of the fields the service lists filter and sort on,
+// one column per field: status and technician as small codes, creation time
+// in unix time, and client name, phone and email folded by fold_text() into
+// StringColumns. Index i describes the same service as rows[i] of the vector
+// it mirrors, and the single-row edits keep it that way.
+class ServiceSnapshot {
+public:
+    // Technician code 0 means not assigned or not known. Codes are 32-bit,
+    // so any number of distinct technicians fits.
+    static constexpr uint32_t NO_TECHNICIAN = 0;
+
+    void reset(const std::vector<ServiceSummary> &rows);
+    void append(const ServiceSummary &row);
+    void insert(uint32_t index, const ServiceSummary &row);
+    void assign(uint32_t index, const ServiceSummary &row);
+    void erase(uint32_t index);
+
+    size_t size() const { return service_id.size(); }
+    int id(uint32_t index) const { return service_id[index]; }
+    ServiceStatus status(uint32_t index) const { return status_[index]; }
+    // created_at, unix time.
+    int64_t created(uint32_t index) const { return created_[index]; }
+    // Folded text, for TextMatcher.
+    std::string_view name_key(uint32_t index) const { return names[index]; }
+    std::string_view phone_key(uint32_t index) const { return phones[index]; }
+    std::string_view email_key(uint32_t index) const { return emails[index]; }
+    // Technician id behind a code, 0 for NO_TECHNICIAN.
+    int technician(uint32_t index) const { return technician_ids[technician_[index]]; }
+    uint32_t technician_code(uint32_t index) const { return technician_[index]; }
+    // Code for a technician id, or NO_TECHNICIAN if no row carries it.
+    uint32_t find_technician(int technician_id) const;
+
+    // Bytes held by the columns, for comparing against the row structs.
+    size_t memory_used() const;
+
+private:
+    uint32_t intern_technician(int technician_id);
+
+    std::vector<int32_t> service_id;
+    std::vector<ServiceStatus> status_;
+    std::vector<int64_t> created_;
+    std::vector<uint32_t> technician_;
+    std::vector<int> technician_ids{0};   // code -> technician id
+    std::unordered_map<int, uint32_t> technician_codes;   // technician id -> code
+    StringColumn names;
+    StringColumn phones;
+    StringColumn emails;
+};
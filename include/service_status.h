@@ -0,0 +1,57 @@
+#pragma once
+// The service lifecycle, shared by the data layer and the UI: the status
+// codes stored in services.status and the moves allowed between them.
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// The value is the integer stored in the database, so a status is never
+// renumbered; new ones go before Unknown, which is never stored.
+enum class ServiceStatus : uint8_t { Open, Diagnosing, Repair, Done, Delivered, Canceled, Unknown };
+constexpr size_t SERVICE_STATUS_COUNT = size_t(ServiceStatus::Unknown);
+
+// Same order as ServiceStatus.
+inline constexpr const char *SERVICE_STATUS_NAMES[SERVICE_STATUS_COUNT] = {
+    "open", "diagnosing", "repair", "done", "delivered", "canceled",
+};
+
+constexpr ServiceStatus status_code(std::string_view name) {
+    for (size_t i = 0; i < SERVICE_STATUS_COUNT; i++) {
+        if (name == SERVICE_STATUS_NAMES[i]) return ServiceStatus(i);
+    }
+    return ServiceStatus::Unknown;
+}
+
+constexpr const char *status_name(ServiceStatus status) {
+    return status == ServiceStatus::Unknown ? "" : SERVICE_STATUS_NAMES[size_t(status)];
+}
+
+// STATUS_TRANSITIONS[from][to] tells whether a service may move from one
+// status to another. A canceled order can be reopened; a delivered one is
+// final.
+inline constexpr bool STATUS_TRANSITIONS[SERVICE_STATUS_COUNT][SERVICE_STATUS_COUNT] = {
+    //                open   diagn. repair done   deliv. cancel
+    /* open */       {false, true,  false, false, false, true },
+    /* diagnosing */ {false, false, true,  true,  false, true },
+    /* repair */     {false, true,  false, true,  false, true },
+    /* done */       {false, false, true,  false, true,  false},
+    /* delivered */  {false, false, false, false, false, false},
+    /* canceled */   {true,  false, false, false, false, false},
+};
+
+// Work on the service is over; entering one of these sets closed_at.
+constexpr bool is_closed(ServiceStatus status) {
+    return status == ServiceStatus::Done || status == ServiceStatus::Delivered
+        || status == ServiceStatus::Canceled;
+}
+
+// Keeping the same status always passes; Unknown never does.
+constexpr bool can_transition(ServiceStatus from, ServiceStatus to) {
+    if (from == ServiceStatus::Unknown || to == ServiceStatus::Unknown) return false;
+    return from == to || STATUS_TRANSITIONS[size_t(from)][size_t(to)];
+}
+
+static_assert(status_code("repair") == ServiceStatus::Repair);
+static_assert(can_transition(ServiceStatus::Open, ServiceStatus::Diagnosing));
+static_assert(!can_transition(ServiceStatus::Delivered, ServiceStatus::Open));
+static_assert(!can_transition(ServiceStatus::Unknown, ServiceStatus::Unknown));
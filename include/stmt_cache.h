@@ -0,0 +1,29 @@
+#pragma once
+#include <sqlite3.h>
+
+struct StmtCacheEntry;
+
+// Prepared statements are cached per connection, keyed by their SQL text.
+// A CachedStmt checks one out for the duration of a call; on destruction it
+// is reset and its bindings cleared so the next caller can reuse it.  If the
+// cached statement is already checked out (nested call with the same SQL), a
+// private statement is prepared and finalized instead.
+class CachedStmt {
+public:
+    CachedStmt(sqlite3 *db, const char *sql);
+    ~CachedStmt();
+
+    CachedStmt(const CachedStmt&) = delete;
+    CachedStmt& operator=(const CachedStmt&) = delete;
+
+    sqlite3_stmt *get() const { return stmt; }
+    operator sqlite3_stmt*() const { return stmt; }
+    explicit operator bool() const { return stmt != nullptr; }
+
+private:
+    sqlite3_stmt *stmt = nullptr;
+    StmtCacheEntry *entry = nullptr;
+};
+
+// Finalizes every cached statement of db. Must run before sqlite3_close.
+void clear_statement_cache(sqlite3 *db);
@@ -0,0 +1,46 @@
+#pragma once
+#include <gtkmm.h>
+#include <memory>
+#include <optional>
+#include <unordered_set>
+#include "main.h"
+#include "change_feed.h"
+#include "db_executor.h"
+
+// A service's timeline, newest first, with a field to add a note. Nothing
+// is read until the view is built; then the first page comes from the
+// executor and later pages follow as the user scrolls to the bottom, so a
+// service with hundreds of entries opens as fast as one with a few.
+// Entries written while the view is open, from here or from an edit, arrive
+// through the change feed.
+class TimelineView : public Gtk::Box {
+public:
+    TimelineView(DbExecutor &executor_, ChangeFeed &feed_, int service_id_, int user_id_);
+    ~TimelineView() override;
+
+private:
+    void load_more();
+    void on_changes(const ChangeSet &changes);
+    void add_note();
+    // Adds e at the top or the bottom unless it is already shown.
+    void show_entry(const TimelineEntry &e, bool at_top);
+
+    DbExecutor &executor;
+    ChangeFeed &feed;
+    size_t subscription;
+    int service_id;
+    int user_id;
+    // Completions check it, since the view may be gone when they run.
+    std::shared_ptr<bool> alive = std::make_shared<bool>(true);
+    std::optional<TimelineCursor> next;
+    bool loading = false;
+    bool at_end = false;
+    std::unordered_set<int> shown;   // history ids
+
+    Gtk::Box note_row{Gtk::Orientation::HORIZONTAL, 6};
+    Gtk::Entry note_entry;
+    Gtk::Button add_btn{"Add note"};
+    Gtk::ScrolledWindow scroller;
+    Gtk::Box entries{Gtk::Orientation::VERTICAL, 0};
+    Gtk::Label empty_label{"No history yet"};
+};
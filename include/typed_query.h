@@ -0,0 +1,137 @@
+#pragma once
+#include <sqlite3.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Typed parameter binding and column mapping for prepared statements.
+//
+// bind_args() picks the sqlite3_bind_* call from each argument's type.
+// Text is bound SQLITE_STATIC, so SQLite keeps a pointer instead of a copy;
+// the argument must outlive the last sqlite3_step(), which holds for
+// parameters of the calling function since CachedStmt clears its bindings
+// when it goes out of scope. Temporary strings are rejected at compile
+// time for that reason.
+//
+// RowMapping reads columns straight into the members of a row struct, the
+// type of each member choosing how; enums are stored as their integer
+// value. Only std::optional members tell NULL apart; a plain std::string,
+// std::string_view, number or enum reads NULL as empty or 0, so a NULL
+// column can never turn into a null pointer. A std::string_view points into
+// the statement and is valid until the next step or reset.
+
+namespace typed_query {
+
+template<class T> struct is_optional : std::false_type {};
+template<class T> struct is_optional<std::optional<T>> : std::true_type {};
+
+inline int bind_value(sqlite3_stmt *stmt, int idx, int value) {
+    return sqlite3_bind_int(stmt, idx, value);
+}
+inline int bind_value(sqlite3_stmt *stmt, int idx, sqlite3_int64 value) {
+    return sqlite3_bind_int64(stmt, idx, value);
+}
+inline int bind_value(sqlite3_stmt *stmt, int idx, double value) {
+    return sqlite3_bind_double(stmt, idx, value);
+}
+inline int bind_value(sqlite3_stmt *stmt, int idx, std::string_view value) {
+    // a zero-length text still binds '' rather than NULL
+    return sqlite3_bind_text(stmt, idx, value.data() ? value.data() : "", int(value.size()), SQLITE_STATIC);
+}
+inline int bind_value(sqlite3_stmt *stmt, int idx, const std::string &value) {
+    return bind_value(stmt, idx, std::string_view(value));
+}
+inline int bind_value(sqlite3_stmt *stmt, int idx, const char *value) {
+    return bind_value(stmt, idx, std::string_view(value));
+}
+// would dangle before the statement runs
+int bind_value(sqlite3_stmt *stmt, int idx, std::string &&value) = delete;
+int bind_value(sqlite3_stmt *stmt, int idx, std::optional<std::string> &&value) = delete;
+// an enum is stored as its integer value
+template<class E> requires std::is_enum_v<E>
+int bind_value(sqlite3_stmt *stmt, int idx, E value) {
+    return sqlite3_bind_int(stmt, idx, int(value));
+}
+inline int bind_value(sqlite3_stmt *stmt, int idx, std::nullopt_t) {
+    return sqlite3_bind_null(stmt, idx);
+}
+template<class T>
+int bind_value(sqlite3_stmt *stmt, int idx, const std::optional<T> &value) {
+    return value ? bind_value(stmt, idx, *value) : sqlite3_bind_null(stmt, idx);
+}
+
+// Reads column col as T.
+template<class T>
+T column(sqlite3_stmt *stmt, int col) {
+    if constexpr (is_optional<T>::value) {
+        if (sqlite3_column_type(stmt, col) == SQLITE_NULL) return std::nullopt;
+        return column<typename T::value_type>(stmt, col);
+    } else if constexpr (std::is_same_v<T, int>) {
+        return sqlite3_column_int(stmt, col);
+    } else if constexpr (std::is_same_v<T, sqlite3_int64>) {
+        return sqlite3_column_int64(stmt, col);
+    } else if constexpr (std::is_same_v<T, double>) {
+        return sqlite3_column_double(stmt, col);
+    } else if constexpr (std::is_enum_v<T>) {
+        return T(sqlite3_column_int(stmt, col));
+    } else if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>) {
+        // text first, then its length, as sqlite3_column_bytes() may convert
+        auto text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, col));
+        if (!text) return T();
+        return T(text, size_t(sqlite3_column_bytes(stmt, col)));
+    } else {
+        static_assert(!sizeof(T), "column type must be int, sqlite3_int64, double, an enum, "
+                                  "std::string, std::string_view or std::optional of one of them");
+    }
+}
+
+// Like column<std::string>(), but reuses the capacity target already has.
+inline void read_column(sqlite3_stmt *stmt, int col, std::string &target) {
+    auto text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, col));
+    if (text) target.assign(text, size_t(sqlite3_column_bytes(stmt, col)));
+    else target.clear();
+}
+template<class T>
+void read_column(sqlite3_stmt *stmt, int col, T &target) {
+    target = column<T>(stmt, col);
+}
+
+template<class M> struct member_of;
+template<class R, class T> struct member_of<T R::*> {
+    using row = R;
+    using type = T;
+};
+
+}
+
+// Binds args to parameters 1, 2, ... in order. False if any bind fails.
+template<class... Args>
+bool bind_args(sqlite3_stmt *stmt, Args &&...args) {
+    int idx = 0;
+    return ((typed_query::bind_value(stmt, ++idx, std::forward<Args>(args)) == SQLITE_OK) && ...);
+}
+
+// Result columns 0, 1, ... of a statement mapped onto the listed members of
+// a row struct, e.g. RowMapping<UserRow, &UserRow::user_id, &UserRow::username>.
+// Members may belong to a base of Row.
+template<class Row, auto... Members>
+struct RowMapping {
+    static_assert(sizeof...(Members) > 0, "map at least one column");
+    static_assert((std::is_base_of_v<typename typed_query::member_of<decltype(Members)>::row, Row> && ...),
+                  "every member must belong to Row or one of its bases");
+
+    static void read_into(sqlite3_stmt *stmt, Row &row) {
+        int col = 0;
+        (typed_query::read_column(stmt, col++, row.*Members), ...);
+    }
+
+    static Row read(sqlite3_stmt *stmt) {
+        Row row;
+        read_into(stmt, row);
+        return row;
+    }
+};
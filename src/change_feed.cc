@@ -0,0 +1,95 @@
+#include "../include/change_feed.h"
+#include <algorithm>
+#include <cstring>
+
+ChangeFeed::ChangeFeed(sqlite3 *db_, std::vector<std::string> tables_, Poster post_)
+: db(db_), tables(std::move(tables_)), post(std::move(post_))
+{
+    sqlite3_update_hook(db, &ChangeFeed::on_update, this);
+    sqlite3_commit_hook(db, &ChangeFeed::on_commit, this);
+    sqlite3_rollback_hook(db, &ChangeFeed::on_rollback, this);
+}
+
+ChangeFeed::~ChangeFeed() {
+    sqlite3_update_hook(db, nullptr, nullptr);
+    sqlite3_commit_hook(db, nullptr, nullptr);
+    sqlite3_rollback_hook(db, nullptr, nullptr);
+}
+
+void ChangeFeed::on_update(void *self, int op, const char *db_name, const char *table, sqlite3_int64 rowid) {
+    auto feed = static_cast<ChangeFeed*>(self);
+    if (strcmp(db_name, "main") != 0) return;
+    auto it = std::find(feed->tables.begin(), feed->tables.end(), table);
+    if (it == feed->tables.end()) return;
+    ChangeOp change = op == SQLITE_INSERT ? ChangeOp::Insert
+                    : op == SQLITE_DELETE ? ChangeOp::Delete
+                    : ChangeOp::Update;
+    feed->record(int(it - feed->tables.begin()), change, rowid);
+}
+
+void ChangeFeed::record(int table, ChangeOp op, sqlite3_int64 rowid) {
+    auto [it, inserted] = pending_index.try_emplace({table, rowid}, pending.size());
+    if (inserted) {
+        pending.push_back(Pending{table, op, rowid, false});
+        return;
+    }
+    Pending &p = pending[it->second];
+    if (p.dropped) {
+        p = Pending{table, op, rowid, false};
+    } else if (p.op == ChangeOp::Insert) {
+        if (op == ChangeOp::Delete) p.dropped = true;      // never existed outside the transaction
+    } else if (p.op == ChangeOp::Delete) {
+        if (op == ChangeOp::Insert) p.op = ChangeOp::Update;
+    } else {
+        p.op = op;                                          // update then update or delete
+    }
+}
+
+int ChangeFeed::on_commit(void *self) {
+    auto feed = static_cast<ChangeFeed*>(self);
+    if (feed->pending.empty()) return 0;
+    ChangeSet changes;
+    changes.reserve(feed->pending.size());
+    for (const auto &p : feed->pending) {
+        if (!p.dropped) changes.push_back(RowChange{feed->tables[p.table], p.op, p.rowid});
+    }
+    feed->pending.clear();
+    feed->pending_index.clear();
+    if (!changes.empty()) {
+        std::lock_guard<std::mutex> lock(feed->mutex);
+        feed->committed.push_back(std::move(changes));
+    }
+    return 0;   // never veto the commit
+}
+
+void ChangeFeed::on_rollback(void *self) {
+    auto feed = static_cast<ChangeFeed*>(self);
+    feed->pending.clear();
+    feed->pending_index.clear();
+}
+
+void ChangeFeed::flush() {
+    std::vector<ChangeSet> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(committed);
+    }
+    for (auto &changes : ready) {
+        post([this, changes = std::move(changes)] { publish(changes); });
+    }
+}
+
+size_t ChangeFeed::subscribe(Listener listener) {
+    listeners.emplace(next_handle, std::move(listener));
+    return next_handle++;
+}
+
+void ChangeFeed::unsubscribe(size_t handle) {
+    listeners.erase(handle);
+}
+
+void ChangeFeed::publish(const ChangeSet &changes) {
+    // a listener may unsubscribe while we iterate
+    auto snapshot = listeners;
+    for (auto &[handle, listener] : snapshot) listener(changes);
+}
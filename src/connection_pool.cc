@@ -0,0 +1,32 @@
+#include "../include/connection_pool.h"
+
+ConnectionPool::ConnectionPool(const std::string &path, size_t size, const DbConfig &config) {
+    for (size_t i = 0; i < size; i++) {
+        sqlite3 *conn = nullptr;
+        if (!open_path(path, conn, config)) break;
+        all.push_back(conn);
+    }
+    idle = all;
+}
+
+ConnectionPool::~ConnectionPool() {
+    for (auto conn : all) {
+        disconnect(conn);
+    }
+}
+
+ConnectionPool::Lease ConnectionPool::acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return !idle.empty(); });
+    sqlite3 *conn = idle.back();
+    idle.pop_back();
+    return Lease(*this, conn);
+}
+
+void ConnectionPool::release(sqlite3 *conn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(conn);
+    }
+    cv.notify_one();
+}
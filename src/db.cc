@@ -1,20 +1,83 @@
-#include "../include/main.h"
+#include "../include/db.h"
+#include "../include/query_trace.h"
+#include "../include/stmt_cache.h"
+#include "../include/typed_query.h"
 #include <sqlite3.h>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
 
 sqlite3 *db = nullptr;
 
-bool connect(std::string username_, sqlite3 *&db) {
-    std::string db_path = std::format("../{}.db", username_);
-    int rc = sqlite3_open(db_path.data(), &db);
+std::optional<sqlite3_int64> parse_utc_time(std::string_view text) {
+    if (text.empty()) return std::nullopt;
+    if (text.size() <= 18 && text.find_first_not_of("0123456789") == std::string_view::npos) {
+        sqlite3_int64 seconds = 0;
+        for (char c : text) seconds = seconds * 10 + (c - '0');
+        return seconds;
+    }
+    std::string s(text);
+    int year, month, day, hour = 0, minute = 0, second = 0, used = 0;
+    if (sscanf(s.c_str(), "%4d-%2d-%2d%n", &year, &month, &day, &used) != 3 || used != 10) return std::nullopt;
+    if (s.size() > 10) {
+        if (s[10] != ' ' && s[10] != 'T') return std::nullopt;
+        if (sscanf(s.c_str() + 11, "%2d:%2d:%2d%n", &hour, &minute, &second, &used) != 3
+            || 11 + size_t(used) != s.size()) return std::nullopt;
+    }
+    if (month < 1 || month > 12 || day < 1 || hour > 23 || minute > 59 || second > 60) return std::nullopt;
+    std::tm tm{};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    time_t t = timegm(&tm);
+    // timegm() rolls 30 February over into March
+    if (tm.tm_mday != day) return std::nullopt;
+    return sqlite3_int64(t);
+}
+
+std::string db_path(const std::string &name) {
+    return "../" + name + ".db";
+}
+
+bool connect(std::string username_, sqlite3 *&db, const DbConfig &config) {
+    return open_path(db_path(username_), db, config);
+}
+
+bool open_path(const std::string &path, sqlite3 *&db, const DbConfig &config) {
+    int flags = config.read_only ? SQLITE_OPEN_READONLY
+                                 : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    int rc = sqlite3_open_v2(path.c_str(), &db, flags, nullptr);
     if (rc != SQLITE_OK) {
         fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(db));
         sqlite3_close(db);
         db = nullptr;
         return false;
     }
+
+    sqlite3_busy_timeout(db, config.busy_timeout_ms);
+    std::string pragmas;
+    if (!config.read_only) {
+        pragmas += "PRAGMA journal_mode = " + config.journal_mode + ";";
+        pragmas += "PRAGMA foreign_keys = ON;";
+    }
+    pragmas += "PRAGMA synchronous = " + config.synchronous + ";";
+    pragmas += "PRAGMA mmap_size = " + std::to_string(config.mmap_size) + ";";
+    pragmas += "PRAGMA cache_size = -" + std::to_string(config.cache_size_kib) + ";";
+    execute_query(pragmas, db);
+    if (config.trace) trace_statements(db);
     return true;
 }
 
+void disconnect(sqlite3 *&db) {
+    if (!db) return;
+    clear_statement_cache(db);
+    sqlite3_close(db);
+    db = nullptr;
+}
+
 void execute_query(const std::string &query, sqlite3 *db) {
     char *err_msg = nullptr;
     if (sqlite3_exec(db, query.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK) {
@@ -23,128 +86,265 @@ void execute_query(const std::string &query, sqlite3 *db) {
     }
 }
 
-void initDatabase(sqlite3 *db) {
-    std::string query = R"(PRAGMA foreign_keys = ON;
-
--- ======================
--- ROLES
--- ======================
-CREATE TABLE IF NOT EXISTS roles (
-    role_id INTEGER PRIMARY KEY AUTOINCREMENT,
-    name TEXT NOT NULL UNIQUE
-);
+// Statements of one savepoint; failures are logged for caller.
+static bool exec_in(sqlite3 *db, const char *sql, const char *caller) {
+    char *err_msg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << caller << ": " << sql << " failed: " << err_msg << std::endl;
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
 
-INSERT OR IGNORE INTO roles (name) VALUES
-('admin'),
-('commercial'),
-('technician');
-
-
--- ======================
--- USERS
--- ======================
-CREATE TABLE IF NOT EXISTS users (
-    user_id INTEGER PRIMARY KEY AUTOINCREMENT,
-    full_name TEXT NOT NULL,
-    email TEXT UNIQUE,
-    username TEXT UNIQUE NOT NULL,
-    access_code_hash TEXT NOT NULL,   -- hashed pass
-    role_id INTEGER NOT NULL,
-    created_at DEFAULT CURRENT_TIMESTAMP,
-    FOREIGN KEY (role_id) REFERENCES roles(role_id)
-);
+void initDatabase(sqlite3 *db) {
+    TraceScope trace("initDatabase");
+    migrate(db);
+}
 
+// Full-text index over the searchable service columns. It is an external
+// content table, so only the index lives in services_fts; the triggers keep
+// it in step with every insert, update and delete on services.
+void init_search_index(sqlite3 *db) {
+    // the insert trigger is created last, so it marks a complete setup
+    {
+        CachedStmt stmt(db, "SELECT 1 FROM sqlite_master WHERE type = 'trigger' AND name = 'services_fts_ai';");
+        if (stmt && sqlite3_step(stmt) == SQLITE_ROW) return;
+    }
 
--- ======================
--- SERVICE REQUESTS
--- ======================
-CREATE TABLE IF NOT EXISTS services (
-    service_id INTEGER PRIMARY KEY AUTOINCREMENT,
-    client_name TEXT NOT NULL,
-    client_phone TEXT,
-    client_email TEXT,
-    equipment_desc TEXT,              
-    problem_report TEXT,
-    created_by_id INTEGER NOT NULL,
-    status TEXT NOT NULL DEFAULT 'open'
-        CHECK(status IN ('open','diagnosing','repair','done','delivered','canceled')),
-    created_at DEFAULT CURRENT_TIMESTAMP,
-    closed_at,
-    FOREIGN KEY (created_by_id) REFERENCES users(user_id)
+    std::string query = R"(
+CREATE VIRTUAL TABLE IF NOT EXISTS services_fts USING fts5(
+    client_name, client_phone, client_email, equipment_desc, problem_report,
+    content='services', content_rowid='service_id',
+    tokenize='unicode61 remove_diacritics 2', prefix='2 3'
 );
 
+CREATE TRIGGER IF NOT EXISTS services_fts_ad AFTER DELETE ON services BEGIN
+    INSERT INTO services_fts(services_fts, rowid, client_name, client_phone, client_email, equipment_desc, problem_report)
+    VALUES ('delete', old.service_id, old.client_name, old.client_phone, old.client_email, old.equipment_desc, old.problem_report);
+END;
+
+CREATE TRIGGER IF NOT EXISTS services_fts_au
+AFTER UPDATE OF client_name, client_phone, client_email, equipment_desc, problem_report ON services BEGIN
+    INSERT INTO services_fts(services_fts, rowid, client_name, client_phone, client_email, equipment_desc, problem_report)
+    VALUES ('delete', old.service_id, old.client_name, old.client_phone, old.client_email, old.equipment_desc, old.problem_report);
+    INSERT INTO services_fts(rowid, client_name, client_phone, client_email, equipment_desc, problem_report)
+    VALUES (new.service_id, new.client_name, new.client_phone, new.client_email, new.equipment_desc, new.problem_report);
+END;
+
+-- index the rows that existed before the search table did
+INSERT INTO services_fts(services_fts) VALUES ('rebuild');
+
+CREATE TRIGGER IF NOT EXISTS services_fts_ai AFTER INSERT ON services BEGIN
+    INSERT INTO services_fts(rowid, client_name, client_phone, client_email, equipment_desc, problem_report)
+    VALUES (new.service_id, new.client_name, new.client_phone, new.client_email, new.equipment_desc, new.problem_report);
+END;
+)";
 
--- ======================
--- SERVICE HISTORY (log of service stage changes or text notes)
--- ======================
-CREATE TABLE IF NOT EXISTS service_history (
-    history_id INTEGER PRIMARY KEY AUTOINCREMENT,
-    service_id INTEGER NOT NULL,
-    user_id INTEGER,
-    note TEXT,
-    status TEXT CHECK(status IN ('open','diagnosing','repair','done','delivered','canceled')),
-    created_at DEFAULT CURRENT_TIMESTAMP,
-    FOREIGN KEY(service_id) REFERENCES services(service_id),
-    FOREIGN KEY(user_id) REFERENCES users(user_id)
-);
-
+    char *err_msg = nullptr;
+    if (sqlite3_exec(db, ("SAVEPOINT init_search;" + query).c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "full-text search unavailable: " << err_msg << std::endl;
+        sqlite3_free(err_msg);
+        execute_query("ROLLBACK TO init_search; RELEASE init_search;", db);
+        return;
+    }
+    if (!set_schema_flag(db, SEARCH_INDEX_SUSPENDED, false)) {
+        execute_query("ROLLBACK TO init_search; RELEASE init_search;", db);
+        return;
+    }
+    execute_query("RELEASE init_search;", db);
+}
 
--- ======================
--- ACTION LOGS (who did what)
--- ======================
-CREATE TABLE IF NOT EXISTS action_logs (
-    log_id INTEGER PRIMARY KEY AUTOINCREMENT,
-    user_id INTEGER,
-    action TEXT NOT NULL,
-    details TEXT,
-    created_at DEFAULT CURRENT_TIMESTAMP,
-    FOREIGN KEY (user_id) REFERENCES users(user_id)
-);
+void suspend_search_index(sqlite3 *db) {
+    if (!search_available(db)) return;
+    // flagged in the same savepoint, so the next start sees the trigger gone
+    bool ok = exec_in(db, "SAVEPOINT suspend_search;", "suspend_search_index") &&
+              set_schema_flag(db, SEARCH_INDEX_SUSPENDED, true) &&
+              exec_in(db, "DROP TRIGGER IF EXISTS services_fts_ai;", "suspend_search_index");
+    execute_query(ok ? "RELEASE suspend_search;" : "ROLLBACK TO suspend_search; RELEASE suspend_search;", db);
+}
 
+// Recounts service_counts from scratch by dropping it and its triggers and
+// running migration 5 again, so the counts keep the schema that shipped.
+bool init_service_counts(sqlite3 *db) {
+    const char *drop = "SAVEPOINT init_counts;"
+                       "DROP TRIGGER IF EXISTS service_counts_insert;"
+                       "DROP TRIGGER IF EXISTS service_counts_update;"
+                       "DROP TRIGGER IF EXISTS service_counts_delete;"
+                       "DROP TRIGGER IF EXISTS service_counts_assign;"
+                       "DROP TRIGGER IF EXISTS service_counts_unassign;"
+                       "DROP TABLE IF EXISTS service_counts;";
+    if (!exec_in(db, drop, "init_service_counts") || !replay_migration(db, 5) ||
+        !set_schema_flag(db, SERVICE_COUNTS_SUSPENDED, false)) {
+        execute_query("ROLLBACK TO init_counts; RELEASE init_counts;", db);
+        return false;
+    }
+    return exec_in(db, "RELEASE init_counts;", "init_service_counts");
+}
 
--- ======================
--- CHANGE LOGS
--- Stores old → new value per field
--- ======================
-CREATE TABLE IF NOT EXISTS change_logs (
-    change_id INTEGER PRIMARY KEY AUTOINCREMENT,
-    change_type TEXT,
-    service_id INTEGER,
-    user_id INTEGER,
-    field TEXT NOT NULL,
-    old_value TEXT,
-    new_value TEXT,
-    created_at DEFAULT CURRENT_TIMESTAMP,
-    FOREIGN KEY(service_id) REFERENCES services(service_id),
-    FOREIGN KEY(user_id) REFERENCES users(user_id)
-);
+void suspend_service_counts(sqlite3 *db) {
+    bool ok = exec_in(db, "SAVEPOINT suspend_counts;", "suspend_service_counts") &&
+              set_schema_flag(db, SERVICE_COUNTS_SUSPENDED, true) &&
+              exec_in(db, "DROP TRIGGER IF EXISTS service_counts_insert; "
+                          "DROP TRIGGER IF EXISTS service_counts_assign;", "suspend_service_counts");
+    execute_query(ok ? "RELEASE suspend_counts;" : "ROLLBACK TO suspend_counts; RELEASE suspend_counts;", db);
+}
 
-CREATE TABLE IF NOT EXISTS service_technicians (
-    service_id INTEGER NOT NULL,
-    technician_id INTEGER NOT NULL,
-    assigned_at DEFAULT CURRENT_TIMESTAMP,
-    PRIMARY KEY (service_id, technician_id),
-    FOREIGN KEY (service_id) REFERENCES services(service_id) ON DELETE CASCADE,
-    FOREIGN KEY (technician_id) REFERENCES users(user_id) ON DELETE CASCADE
-);
+bool search_available(sqlite3 *db) {
+    CachedStmt stmt(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'services_fts';");
+    if (!stmt) return false;
+    return sqlite3_step(stmt) == SQLITE_ROW;
+}
 
-)";
+// Turns free text into an FTS5 query: every word becomes a quoted prefix
+// term, so user input can never be parsed as FTS5 syntax.
+static std::string fts_query(const std::string &text) {
+    std::string out;
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && isspace((unsigned char)text[i])) i++;
+        if (i == text.size()) break;
+        std::string term;
+        while (i < text.size() && !isspace((unsigned char)text[i])) {
+            if (text[i] == '"') term += '"';
+            term += text[i++];
+        }
+        if (!out.empty()) out += ' ';
+        out += '"' + term + "\"*";
+    }
+    return out;
+}
 
-    execute_query(query, db);
+// The lowest-numbered technician assigned to s. ORDER BY ... LIMIT 1 stops at
+// the first primary key entry, where MIN() would run an aggregate per row.
+#define FIRST_TECHNICIAN \
+    "(SELECT t.technician_id FROM service_technicians t WHERE t.service_id = s.service_id " \
+    "ORDER BY t.technician_id LIMIT 1)"
+
+// SQL of every statement below, kept together so unindexed_scans() can run
+// EXPLAIN QUERY PLAN over all of them.
+// What the lists read: SERVICE_COLUMNS without the equipment and problem
+// report, which a list never shows, so they are neither decoded nor copied.
+#define SUMMARY_SELECT \
+    "SELECT s.service_id, s.client_name, s.client_phone, s.client_email, s.status, s.created_at, " \
+    FIRST_TECHNICIAN
+#define SUMMARY_COLUMNS SUMMARY_SELECT " FROM services s"
+#define SERVICE_COLUMNS SUMMARY_SELECT ", s.equipment_desc, s.problem_report, s.created_by_id, s.closed_at FROM services s"
+#define ASSIGNED_JOIN \
+    " JOIN service_technicians st ON st.service_id = s.service_id WHERE st.technician_id = ?"
+#define SERVICE_ORDER " ORDER BY s.created_at DESC, s.service_id DESC"
+#define KEYSET_AFTER "(s.created_at, s.service_id) < (?, ?)"
+#define CREATED_WITHIN "s.created_at >= ? AND s.created_at < ?"
+
+namespace sql {
+constexpr char user_exists[] = "SELECT 1 FROM users WHERE username = ? LIMIT 1;";
+constexpr char insert_user[] =
+    "INSERT INTO users (full_name, email, username, access_code_hash, role_id) "
+    "VALUES (?, ?, ?, ?, ?);";
+constexpr char user_by_name[] = "SELECT user_id, username, full_name, email, role_id FROM users WHERE full_name = ? LIMIT 1;";
+constexpr char user_by_id[] = "SELECT user_id, username, full_name, email, role_id FROM users WHERE user_id = ? LIMIT 1;";
+constexpr char login[] =
+    "SELECT user_id, full_name, role_id "
+    "FROM users "
+    "WHERE username = ? AND access_code_hash = ? "
+    "LIMIT 1;";
+constexpr char update_user[] = "UPDATE users SET full_name=?, email=?, username=?, role_id=? WHERE user_id=?;";
+constexpr char delete_user[] = "DELETE FROM users WHERE user_id = ?;";
+constexpr char list_users[] = "SELECT user_id, username, full_name, email, role_id FROM users ORDER BY username;";
+
+constexpr char services[] = SUMMARY_COLUMNS SERVICE_ORDER ";";
+constexpr char assigned_services[] = SUMMARY_COLUMNS ASSIGNED_JOIN SERVICE_ORDER ";";
+constexpr char service_by_id[] = SERVICE_COLUMNS " WHERE s.service_id = ?;";
+constexpr char summary_by_id[] = SUMMARY_COLUMNS " WHERE s.service_id = ?;";
+// service_counts is kept by the triggers of migration 5, see migrations.cc, and
+// recounted by init_service_counts() after a bulk load
+constexpr char status_counts[] = "SELECT status, count FROM service_counts WHERE scope = 0 AND key = 0;";
+constexpr char recent_counts[] =
+    "SELECT status, sum(count) FROM service_counts WHERE scope = 2 AND key >= ? GROUP BY status;";
+constexpr char technician_counts[] =
+    "SELECT c.key, u.full_name, c.status, c.count FROM service_counts c "
+    "LEFT JOIN users u ON u.user_id = c.key WHERE c.scope = 1 AND c.count > 0 ORDER BY c.key;";
+constexpr char services_page[] = SUMMARY_COLUMNS " WHERE " CREATED_WITHIN SERVICE_ORDER " LIMIT ?;";
+constexpr char services_page_after[] =
+    SUMMARY_COLUMNS " WHERE " CREATED_WITHIN " AND " KEYSET_AFTER SERVICE_ORDER " LIMIT ?;";
+constexpr char assigned_page[] = SUMMARY_COLUMNS ASSIGNED_JOIN " AND " CREATED_WITHIN SERVICE_ORDER " LIMIT ?;";
+constexpr char assigned_page_after[] =
+    SUMMARY_COLUMNS ASSIGNED_JOIN " AND " CREATED_WITHIN " AND " KEYSET_AFTER SERVICE_ORDER " LIMIT ?;";
+// bm25 weights follow the column order: the client name counts most
+constexpr char search_services[] =
+    SUMMARY_SELECT " FROM services_fts JOIN services s ON s.service_id = services_fts.rowid "
+    "WHERE services_fts MATCH ? AND " CREATED_WITHIN " "
+    "ORDER BY bm25(services_fts, 10.0, 5.0, 5.0, 2.0, 1.0) LIMIT ?;";
+constexpr char insert_service[] =
+    "INSERT INTO services (client_name, client_phone, client_email, equipment_desc, problem_report, created_by_id) "
+    "VALUES (?, ?, ?, ?, ?, ?);";
+// closed_at is stamped when the status moves into a closed one (?7 true)
+// and cleared when it moves out; an edit that keeps the status keeps it
+constexpr char update_service[] =
+    "UPDATE services SET client_name=?1, client_phone=?2, client_email=?3, equipment_desc=?4, problem_report=?5, "
+    "closed_at = CASE WHEN status = ?6 THEN closed_at "
+    "WHEN ?7 THEN coalesce(closed_at, CAST(strftime('%s', 'now') AS INTEGER)) END, "
+    "status=?6 WHERE service_id=?8;";
+constexpr char delete_service[] = "DELETE FROM services WHERE service_id = ?;";
+constexpr char assign_technician[] =
+    "INSERT INTO service_technicians (service_id, technician_id) "
+    "VALUES (?, ?);";
+constexpr char assignment_by_rowid[] =
+    "SELECT service_id, technician_id FROM service_technicians WHERE rowid = ?;";
+constexpr char insert_change_log[] =
+    "INSERT INTO change_logs (change_type, service_id, user_id, field, old_value, new_value) "
+    "VALUES (?, ?, ?, ?, ?, ?);";
+constexpr char delete_change_logs[] = "DELETE FROM change_logs WHERE service_id = ?;";
+#define TIMELINE_COLUMNS \
+    "SELECT h.history_id, h.service_id, h.user_id, u.full_name, h.note, h.status, h.created_at " \
+    "FROM service_history h LEFT JOIN users u ON u.user_id = h.user_id"
+#define TIMELINE_ORDER " ORDER BY h.created_at DESC, h.history_id DESC"
+constexpr char timeline_page[] = TIMELINE_COLUMNS " WHERE h.service_id = ?" TIMELINE_ORDER " LIMIT ?;";
+constexpr char timeline_page_after[] =
+    TIMELINE_COLUMNS " WHERE h.service_id = ? AND (h.created_at, h.history_id) < (?, ?)" TIMELINE_ORDER " LIMIT ?;";
+constexpr char timeline_entry[] = TIMELINE_COLUMNS " WHERE h.history_id = ?;";
+constexpr char insert_history[] =
+    "INSERT INTO service_history (service_id, user_id, note, status) VALUES (?, ?, ?, ?);";
+constexpr char delete_history[] = "DELETE FROM service_history WHERE service_id = ?;";
+
+constexpr const char *all[] = {
+    user_exists, insert_user, user_by_name, user_by_id, login, update_user,
+    delete_user, list_users, service_by_id, summary_by_id, status_counts, recent_counts,
+    technician_counts, services, assigned_services, services_page,
+    services_page_after, assigned_page, assigned_page_after, insert_service,
+    update_service, delete_service, assign_technician, assignment_by_rowid,
+    insert_change_log, delete_change_logs, timeline_page, timeline_page_after, timeline_entry,
+    insert_history, delete_history,
+};
 }
 
-bool user_exists(const std::string &username, sqlite3 *db) {
-    std::string sql = "SELECT 1 FROM users WHERE username = ? LIMIT 1;";
-    sqlite3_stmt *stmt;
-    bool exists = false;
+// Column lists of the SELECTs above, in order.
+using UserColumns = RowMapping<UserRow, &UserRow::user_id, &UserRow::username, &UserRow::full_name,
+                               &UserRow::email, &UserRow::role_id>;
+using LoginColumns = RowMapping<LoginResult, &LoginResult::user_id, &LoginResult::full_name,
+                                &LoginResult::role_id>;
+using SummaryColumns = RowMapping<ServiceSummary, &ServiceSummary::service_id,
+                                  &ServiceSummary::client_name, &ServiceSummary::phone_number,
+                                  &ServiceSummary::email, &ServiceSummary::status,
+                                  &ServiceSummary::created_at, &ServiceSummary::technician_id>;
+using ServiceColumns = RowMapping<ServiceRow, &ServiceRow::service_id, &ServiceRow::client_name,
+                                  &ServiceRow::phone_number, &ServiceRow::email,
+                                  &ServiceRow::status, &ServiceRow::created_at,
+                                  &ServiceRow::technician_id, &ServiceRow::equipment,
+                                  &ServiceRow::problem_report, &ServiceRow::created_by_id,
+                                  &ServiceRow::closed_at>;
+using TimelineColumns = RowMapping<TimelineEntry, &TimelineEntry::history_id, &TimelineEntry::service_id,
+                                   &TimelineEntry::user_id, &TimelineEntry::user_name,
+                                   &TimelineEntry::note, &TimelineEntry::status,
+                                   &TimelineEntry::created_at>;
 
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-        if (sqlite3_step(stmt) == SQLITE_ROW) exists = true;
-    }
+bool user_exists(const std::string &username, sqlite3 *db) {
+    TraceScope trace("user_exists");
+    CachedStmt stmt(db, sql::user_exists);
+    if (!stmt) return false;
 
-    sqlite3_finalize(stmt);
-    return exists;
+    bind_args(stmt, username);
+    return sqlite3_step(stmt) == SQLITE_ROW;
 }
 
 
@@ -157,136 +357,68 @@ bool add_user(const std::string &full_name,
               const int &role_id,
               sqlite3 *db)
 {
+    TraceScope trace("add_user");
     if (user_exists(username, db)) {
         std::cout << "User already exists: " << username << std::endl;
         return -1;
     }
 
-    const char *sql =
-        "INSERT INTO users (full_name, email, username, access_code_hash, role_id) "
-        "VALUES (?, ?, ?, ?, ?);";
-
-    sqlite3_stmt *stmt = nullptr;
+    CachedStmt stmt(db, sql::insert_user);
 
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (!stmt) {
         std::cerr << "prepare failed: " << sqlite3_errmsg(db) << "\n";
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, full_name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, email.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, username.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, access_code_hash.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 5, role_id);
+    bind_args(stmt, full_name, email, username, access_code_hash, role_id);
 
     if (sqlite3_step(stmt) != SQLITE_DONE) {
-        std::cerr << "Error inserting user: " << sqlite3_errmsg(db) << "\endl";
+        std::cerr << "Error inserting user: " << sqlite3_errmsg(db) << "\n";
     } else {
         std::cout << "✅ User inserted: " << username << std::endl;
     }
 
-    sqlite3_finalize(stmt);
     return 1;
 }
 
 std::optional<UserRow> get_user_by_name(std::string full_name, sqlite3 *db) {
-    const char* sql = "SELECT user_id, username, full_name, email, role_id FROM users WHERE full_name = ? LIMIT 1;";
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    TraceScope trace("get_user_by_name");
+    CachedStmt stmt(db, sql::user_by_name);
+    if (!stmt) {
         std::cerr << "get_user_by_full_name prepare failed: " << sqlite3_errmsg(db) << "\n";
         return std::nullopt;
     }
-    sqlite3_bind_text(stmt, 1, full_name.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        UserRow u;
-        u.user_id = sqlite3_column_int(stmt, 0);
-        u.username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        u.full_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        u.email = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3) ? sqlite3_column_text(stmt,3) : (const unsigned char*)"");
-        u.role_id = sqlite3_column_int(stmt, 4);
-        sqlite3_finalize(stmt);
-        return u;
-    }
-    sqlite3_finalize(stmt);
+    bind_args(stmt, full_name);
+    if (sqlite3_step(stmt) == SQLITE_ROW) return UserColumns::read(stmt);
     return std::nullopt;
 }
 
 std::optional<UserRow> get_user_by_id(int user_id, sqlite3 *db) {
-    const char* sql = "SELECT user_id, username, full_name, email, role_id FROM users WHERE user_id = ? LIMIT 1;";
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    TraceScope trace("get_user_by_id");
+    CachedStmt stmt(db, sql::user_by_id);
+    if (!stmt) {
         std::cerr << "get_user_by_id prepare failed: " << sqlite3_errmsg(db) << "\n";
         return std::nullopt;
     }
-    sqlite3_bind_int(stmt, 1, user_id);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        UserRow u;
-        u.user_id = sqlite3_column_int(stmt, 0);
-        u.username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        u.full_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        u.email = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3) ? sqlite3_column_text(stmt,3) : (const unsigned char*)"");
-        u.role_id = sqlite3_column_int(stmt, 4);
-        sqlite3_finalize(stmt);
-        return u;
-    }
-    sqlite3_finalize(stmt);
+    bind_args(stmt, user_id);
+    if (sqlite3_step(stmt) == SQLITE_ROW) return UserColumns::read(stmt);
     return std::nullopt;
 }
 
-// std::optional<UserRow> get_service_by_id(int user_id, sqlite3 *db) {
-//     const char* sql = "SELECT service_id, client, full_name, email, role_id FROM users WHERE user_id = ? LIMIT 1;";
-//     sqlite3_stmt *stmt = nullptr;
-//     if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-//         std::cerr << "get_user_by_id prepare failed: " << sqlite3_errmsg(db) << "\n";
-//         return std::nullopt;
-//     }
-//     sqlite3_bind_int(stmt, 1, user_id);
-//     if (sqlite3_step(stmt) == SQLITE_ROW) {
-//         UserRow u;
-//         u.user_id = sqlite3_column_int(stmt, 0);
-//         u.username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-//         u.full_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-//         u.email = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3) ? sqlite3_column_text(stmt,3) : (const unsigned char*)"");
-//         u.role_id = sqlite3_column_int(stmt, 4);
-//         sqlite3_finalize(stmt);
-//         return u;
-//     }
-//     sqlite3_finalize(stmt);
-//     return std::nullopt;
-// }
-
 
 std::optional<LoginResult> try_login(const std::string& username, const std::string& access_code) {
-    sqlite3_stmt* stmt = nullptr;
-
-    const char* sql =
-        "SELECT user_id, full_name, role_id "
-        "FROM users "
-        "WHERE username = ? AND access_code_hash = ? "
-        "LIMIT 1;";
+    TraceScope trace("try_login");
+    CachedStmt stmt(db, sql::login);
 
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (!stmt) {
         std::cerr << "SQL error (prepare): " << sqlite3_errmsg(db) << "\n";
         return std::nullopt;
     }
 
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, access_code.c_str(), -1, SQLITE_TRANSIENT);
+    bind_args(stmt, username, access_code);
 
-    LoginResult result;
+    if (sqlite3_step(stmt) == SQLITE_ROW) return LoginColumns::read(stmt);
 
-    int rc = sqlite3_step(stmt);
-
-    if (rc == SQLITE_ROW) {
-        result.user_id  = sqlite3_column_int(stmt, 0);
-        result.full_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        result.role_id  = sqlite3_column_int(stmt, 2);
-
-        sqlite3_finalize(stmt);
-        return result;
-    }
-
-    sqlite3_finalize(stmt);
     return std::nullopt;
 }
 
@@ -297,92 +429,190 @@ bool edit_user(int user_id,
                const std::string &username,
                int role_id,
                sqlite3 *db) {
-    const char *sql = "UPDATE users SET full_name=?, email=?, username=?, role_id=? WHERE user_id=?;";
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    TraceScope trace("edit_user");
+    CachedStmt stmt(db, sql::update_user);
+    if (!stmt) {
         std::cerr << "edit_user prepare failed: " << sqlite3_errmsg(db) << "\n";
         return false;
     }
-    sqlite3_bind_text(stmt, 1, full_name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, email.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, username.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 4, role_id);
-    sqlite3_bind_int(stmt, 5, user_id);
+    bind_args(stmt, full_name, email, username, role_id, user_id);
 
-    bool ok = true;
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         std::cerr << "edit_user step error: " << sqlite3_errmsg(db) << "\n";
-        ok = false;
+        return false;
     }
-    sqlite3_finalize(stmt);
-    return ok;
+    return true;
 }
 
 bool delete_user(int user_id, sqlite3 *db) {
-    const char *sql = "DELETE FROM users WHERE user_id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    TraceScope trace("delete_user");
+    CachedStmt stmt(db, sql::delete_user);
+    if (!stmt) {
         std::cerr << "delete_user prepare failed: " << sqlite3_errmsg(db) << "\n";
         return false;
     }
-    sqlite3_bind_int(stmt, 1, user_id);
-    bool ok = true;
+    bind_args(stmt, user_id);
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         std::cerr << "delete_user error: " << sqlite3_errmsg(db) << "\n";
-        ok = false;
+        return false;
     }
-    sqlite3_finalize(stmt);
-    return ok;
+    return true;
 }
 
 std::vector<UserRow> get_users(sqlite3 *db) {
+    TraceScope trace("get_users");
     std::vector<UserRow> out;
-    const char *sql = "SELECT user_id, username, full_name, email, role_id FROM users ORDER BY username;";
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    CachedStmt stmt(db, sql::list_users);
+    if (!stmt) {
         std::cerr << "get_users prepare failed: " << sqlite3_errmsg(db) << "\n";
         return out;
     }
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        UserRow u;
-        u.user_id = sqlite3_column_int(stmt, 0);
-        u.username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        u.full_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        u.email = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3) ? sqlite3_column_text(stmt,3) : (const unsigned char*)"");
-        u.role_id = sqlite3_column_int(stmt, 4);
-        out.push_back(std::move(u));
-    }
-    sqlite3_finalize(stmt);
+        UserColumns::read_into(stmt, out.emplace_back());
+    }
+    trace.rows(out.size());
+    return out;
+}
+
+std::vector<ServiceSummary> get_services(sqlite3 *db, int only_assigned_to) {
+    TraceScope trace("get_services");
+    std::vector<ServiceSummary> out;
+    CachedStmt stmt(db, only_assigned_to > 0 ? sql::assigned_services : sql::services);
+    if (!stmt) {
+        std::cerr << "get_services prepare failed: " << sqlite3_errmsg(db) << "\n";
+        return out;
+    }
+    if (only_assigned_to > 0) bind_args(stmt, only_assigned_to);
+    // straight into the vector; going through for_each_service() would
+    // copy every row once more
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        SummaryColumns::read_into(stmt, out.emplace_back());
+    }
+    trace.rows(out.size());
     return out;
 }
 
-std::vector<ServiceRow> get_services(sqlite3 *db, int only_assigned_to) {
-    std::vector<ServiceRow> out;
-    std::string sql = "SELECT s.service_id, s.client_name, s.client_phone, s.client_email, s.equipment_desc, s.problem_report, s.status FROM services s";
+void for_each_service(sqlite3 *db, int only_assigned_to,
+                      const std::function<bool(const ServiceSummary&)> &fn) {
+    TraceScope trace("for_each_service");
+    CachedStmt stmt(db, only_assigned_to > 0 ? sql::assigned_services : sql::services);
+    if (!stmt) {
+        std::cerr << "for_each_service prepare failed: " << sqlite3_errmsg(db) << "\n";
+        return;
+    }
+    if (only_assigned_to > 0) bind_args(stmt, only_assigned_to);
+    size_t rows = 0;
+    ServiceSummary row;   // reused, so its strings keep their capacity
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        rows++;
+        SummaryColumns::read_into(stmt, row);
+        if (!fn(row)) break;
+    }
+    trace.rows(rows);
+}
+
+std::optional<ServiceRow> get_service_by_id(int service_id, sqlite3 *db) {
+    TraceScope trace("get_service_by_id");
+    CachedStmt stmt(db, sql::service_by_id);
+    if (!stmt) {
+        std::cerr << "get_service_by_id prepare failed: " << sqlite3_errmsg(db) << "\n";
+        return std::nullopt;
+    }
+    bind_args(stmt, service_id);
+    if (sqlite3_step(stmt) == SQLITE_ROW) return ServiceColumns::read(stmt);
+    return std::nullopt;
+}
+
+std::optional<ServiceSummary> get_service_summary(int service_id, sqlite3 *db) {
+    TraceScope trace("get_service_summary");
+    CachedStmt stmt(db, sql::summary_by_id);
+    if (!stmt) {
+        std::cerr << "get_service_summary prepare failed: " << sqlite3_errmsg(db) << "\n";
+        return std::nullopt;
+    }
+    bind_args(stmt, service_id);
+    if (sqlite3_step(stmt) == SQLITE_ROW) return SummaryColumns::read(stmt);
+    return std::nullopt;
+}
+
+// Adds the (status, count) rows of stmt into counts.
+static void read_status_counts(sqlite3_stmt *stmt, std::array<int, SERVICE_STATUS_COUNT> &counts) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto status = typed_query::column<ServiceStatus>(stmt, 0);
+        if (size_t(status) < SERVICE_STATUS_COUNT) counts[size_t(status)] += sqlite3_column_int(stmt, 1);
+    }
+}
+
+std::array<int, SERVICE_STATUS_COUNT> count_services_by_status(sqlite3 *db) {
+    TraceScope trace("count_services_by_status");
+    std::array<int, SERVICE_STATUS_COUNT> counts{};
+    CachedStmt stmt(db, sql::status_counts);
+    if (!stmt) {
+        std::cerr << "count_services_by_status prepare failed: " << sqlite3_errmsg(db) << "\n";
+        return counts;
+    }
+    read_status_counts(stmt, counts);
+    return counts;
+}
+
+ServicePage get_services_page(sqlite3 *db, int only_assigned_to,
+                              const std::optional<ServiceCursor> &after,
+                              int page_size, const TimeRange &created) {
+    TraceScope trace("get_services_page");
+    ServicePage page;
+    const char *query;
     if (only_assigned_to > 0) {
-        sql += " JOIN service_technicians st ON st.service_id = s.service_id WHERE st.technician_id = ? ";
+        query = after ? sql::assigned_page_after : sql::assigned_page;
+    } else {
+        query = after ? sql::services_page_after : sql::services_page;
     }
-    sql += " ORDER BY created_at DESC;";
-    sqlite3_stmt *stmt = nullptr;
-    std::cout << "getting service \n";
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "get_services prepare failed: " << sqlite3_errmsg(db) << "\n";
+    CachedStmt stmt(db, query);
+    if (!stmt) {
+        std::cerr << "get_services_page prepare failed: " << sqlite3_errmsg(db) << "\n";
+        return page;
+    }
+    // one extra row tells us whether another page exists
+    int limit = page_size + 1;
+    if (only_assigned_to > 0 && after) {
+        bind_args(stmt, only_assigned_to, created.from, created.to, after->created_at, after->service_id, limit);
+    } else if (only_assigned_to > 0) {
+        bind_args(stmt, only_assigned_to, created.from, created.to, limit);
+    } else if (after) {
+        bind_args(stmt, created.from, created.to, after->created_at, after->service_id, limit);
+    } else {
+        bind_args(stmt, created.from, created.to, limit);
+    }
+
+    page.rows.reserve(page_size);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if ((int)page.rows.size() == page_size) {
+            const auto &last = page.rows.back();
+            page.next = ServiceCursor{last.created_at, last.service_id};
+            break;
+        }
+        SummaryColumns::read_into(stmt, page.rows.emplace_back());
+    }
+    trace.rows(page.rows.size());
+    return page;
+}
+
+std::vector<ServiceSummary> search_services(const std::string &query, int limit,
+                                            const TimeRange &created, sqlite3 *db) {
+    TraceScope trace("search_services");
+    std::vector<ServiceSummary> out;
+    std::string match = fts_query(query);
+    if (match.empty()) return out;
+
+    CachedStmt stmt(db, sql::search_services);
+    if (!stmt) {
+        std::cerr << "search_services prepare failed: " << sqlite3_errmsg(db) << "\n";
         return out;
     }
-    if (only_assigned_to > 0) sqlite3_bind_int(stmt, 1, only_assigned_to);
+    bind_args(stmt, match, created.from, created.to, limit);
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        ServiceRow s;
-        s.service_id = sqlite3_column_int(stmt, 0);
-        s.client_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt,1));
-        s.phone_number = reinterpret_cast<const char*>(sqlite3_column_text(stmt,2));
-        s.email = reinterpret_cast<const char*>(sqlite3_column_text(stmt,3));
-        s.equipment = reinterpret_cast<const char*>(sqlite3_column_text(stmt,4));
-        s.problem_report = reinterpret_cast<const char*>(sqlite3_column_text(stmt,5) ? sqlite3_column_text(stmt,5) : (const unsigned char*)"");
-        s.status = reinterpret_cast<const char*>(sqlite3_column_text(stmt,6));
-        out.push_back(std::move(s));
-    }
-    sqlite3_finalize(stmt);
-    std::cout <<"got it \n";
+        SummaryColumns::read_into(stmt, out.emplace_back());
+    }
+    trace.rows(out.size());
     return out;
 }
 
@@ -393,129 +623,276 @@ bool add_service(const std::string& client_name,
                  const std::string& problem_report,
                  int created_by_user_id,
                  sqlite3 *db) {
-    const char *sql =
-        "INSERT INTO services (client_name, client_phone, client_email, equipment_desc, problem_report, created_by_id) "
-        "VALUES (?, ?, ?, ?, ?, ?);";
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    TraceScope trace("add_service");
+    CachedStmt stmt(db, sql::insert_service);
+    if (!stmt) {
         std::cerr << "add_service prepare failed: " << sqlite3_errmsg(db) << "\n";
         return false;
     }
-    sqlite3_bind_text(stmt, 1, client_name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, client_phone.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, client_email.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, equipment_desc.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 5, problem_report.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 6, created_by_user_id);
+    bind_args(stmt, client_name, client_phone, client_email, equipment_desc, problem_report,
+              created_by_user_id);
 
-    bool ok = true;
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         std::cerr << "add_service step error: " << sqlite3_errmsg(db) << "\n";
-        ok = false;
-    }
-    sqlite3_finalize(stmt);
-    return ok;
-}
-
-bool edit_service(int service_id,
-                  const std::string& client_name,
-                  const std::string& phone,
-                  const std::string& email,
-                  const std::string& equipment,
-                  const std::string& problem_report,
-                  int technician_id,
-                  const std::string& status,
-                  sqlite3 *db) {
-    const char *sql = "UPDATE services SET client_name=?, client_phone=?, client_email=?, equipment_desc=?, problem_report=?, status=? WHERE service_id=?;";
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    return true;
+}
+
+std::vector<FieldChange> diff_service(const ServiceRow &before, const ServiceRow &after) {
+    std::vector<FieldChange> out;
+    auto compare = [&](const char *field, std::string_view old_value, std::string_view new_value) {
+        if (old_value != new_value) out.push_back(FieldChange{field, std::string(old_value), std::string(new_value)});
+    };
+    compare("client_name", before.client_name, after.client_name);
+    compare("client_phone", before.phone_number, after.phone_number);
+    compare("client_email", before.email, after.email);
+    compare("equipment_desc", before.equipment, after.equipment);
+    compare("problem_report", before.problem_report, after.problem_report);
+    // logged by name, so the log reads the same whatever the stored code
+    compare("status", status_name(before.status), status_name(after.status));
+    return out;
+}
+
+bool add_change_logs(int service_id, int user_id, const std::string &change_type,
+                     const std::vector<FieldChange> &changes, sqlite3 *db) {
+    TraceScope trace("add_change_logs");
+    CachedStmt stmt(db, sql::insert_change_log);
+    if (!stmt) {
+        std::cerr << "add_change_logs prepare failed: " << sqlite3_errmsg(db) << "\n";
+        return false;
+    }
+    std::optional<int> user;
+    if (user_id > 0) user = user_id;
+    for (const auto &change : changes) {
+        bind_args(stmt, change_type, service_id, user, change.field, change.old_value, change.new_value);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "add_change_logs step error: " << sqlite3_errmsg(db) << "\n";
+            return false;
+        }
+        sqlite3_reset(stmt);
+    }
+    return true;
+}
+
+static bool write_service_edit(const ServiceRow &row, int edited_by_id, sqlite3 *db) {
+    std::optional<ServiceRow> before = get_service_by_id(row.service_id, db);
+    if (!before) {
+        std::cerr << "edit_service: no service " << row.service_id << "\n";
+        return false;
+    }
+    if (!can_transition(before->status, row.status)) {
+        std::cerr << "edit_service: service " << row.service_id << " cannot move from "
+                  << status_name(before->status) << " to " << status_name(row.status) << "\n";
+        return false;
+    }
+    std::vector<FieldChange> changes = diff_service(*before, row);
+    if (changes.empty()) return true;
+
+    CachedStmt stmt(db, sql::update_service);
+    if (!stmt) {
         std::cerr << "edit_service prepare failed: " << sqlite3_errmsg(db) << "\n";
         return false;
     }
-    sqlite3_bind_text(stmt, 1, client_name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, phone.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, email.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, equipment.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 5, problem_report.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 6, status.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 7, service_id);
+    bind_args(stmt, row.client_name, row.phone_number, row.email, row.equipment,
+              row.problem_report, row.status, int(is_closed(row.status)), row.service_id);
 
-    bool ok = true;
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         std::cerr << "edit_service step error: " << sqlite3_errmsg(db) << "\n";
-        ok = false;
+        return false;
     }
-    sqlite3_finalize(stmt);
-    return ok;
+    if (!add_change_logs(row.service_id, edited_by_id, "edit", changes, db)) return false;
+    if (row.status == before->status) return true;
+    return add_timeline_entry(row.service_id, edited_by_id, "", row.status, db);
 }
 
-bool delete_service(int service_id, sqlite3 *db) {
-    const char *sql = "DELETE FROM services WHERE service_id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+bool edit_service(const ServiceRow &row, int edited_by_id, sqlite3 *db) {
+    TraceScope trace("edit_service");
+    // A savepoint starts its own transaction outside one and nests inside
+    // the executor's group commit, so a failed edit only undoes itself.
+    if (!exec_in(db, "SAVEPOINT edit_service;", "edit_service")) return false;
+    bool ok = write_service_edit(row, edited_by_id, db);
+    if (!ok) exec_in(db, "ROLLBACK TO edit_service;", "edit_service");
+    return exec_in(db, "RELEASE edit_service;", "edit_service") && ok;
+}
+
+static bool delete_service_rows(int service_id, sqlite3 *db) {
+    // change_logs and service_history reference the service without
+    // ON DELETE CASCADE
+    CachedStmt logs(db, sql::delete_change_logs);
+    CachedStmt history(db, sql::delete_history);
+    CachedStmt stmt(db, sql::delete_service);
+    if (!logs || !history || !stmt) {
         std::cerr << "delete_service prepare failed: " << sqlite3_errmsg(db) << "\n";
         return false;
     }
-    sqlite3_bind_int(stmt, 1, service_id);
-    bool ok = true;
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
+    bind_args(logs, service_id);
+    bind_args(history, service_id);
+    bind_args(stmt, service_id);
+    if (sqlite3_step(logs) != SQLITE_DONE || sqlite3_step(history) != SQLITE_DONE
+        || sqlite3_step(stmt) != SQLITE_DONE) {
         std::cerr << "delete_service error: " << sqlite3_errmsg(db) << "\n";
-        ok = false;
+        return false;
     }
-    sqlite3_finalize(stmt);
-    return ok;
+    return true;
 }
 
-bool add_log(
-                const std::string& log_type,
-                const int service_id,
-                const std::string& client_name,
-                 const std::string& client_phone,
-                 const std::string& client_email,
-                 const std::string& equipment_desc,
-                 const std::string& problem_report,
-                 int created_by_user_id,
-                 sqlite3 *db) {
-    const char *sql =
-        "INSERT INTO logs (log_type, client_name, client_phone, client_email, equipment_desc, problem_report) "
-        "VALUES (?, ?, ?, ?, ?);";
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "add_service prepare failed: " << sqlite3_errmsg(db) << "\n";
+bool delete_service(int service_id, sqlite3 *db) {
+    TraceScope trace("delete_service");
+    if (!exec_in(db, "SAVEPOINT delete_service;", "delete_service")) return false;
+    bool ok = delete_service_rows(service_id, db);
+    if (!ok) exec_in(db, "ROLLBACK TO delete_service;", "delete_service");
+    return exec_in(db, "RELEASE delete_service;", "delete_service") && ok;
+}
+
+ServiceCounts get_service_counts(int recent_days, sqlite3 *db) {
+    TraceScope trace("get_service_counts");
+    ServiceCounts counts;
+    CachedStmt totals(db, sql::status_counts);
+    CachedStmt recent(db, sql::recent_counts);
+    CachedStmt technicians(db, sql::technician_counts);
+    if (!totals || !recent || !technicians) {
+        std::cerr << "get_service_counts prepare failed: " << sqlite3_errmsg(db) << "\n";
+        return counts;
+    }
+    // one read transaction, so the three reads agree with each other
+    if (!exec_in(db, "SAVEPOINT service_counts;", "get_service_counts")) return counts;
+    read_status_counts(totals, counts.by_status);
+    sqlite3_int64 today = sqlite3_int64(time(nullptr)) / 86400;
+    bind_args(recent, today - std::max(recent_days, 1) + 1);
+    read_status_counts(recent, counts.recent);
+    while (sqlite3_step(technicians) == SQLITE_ROW) {
+        int technician_id = sqlite3_column_int(technicians, 0);
+        if (counts.technicians.empty() || counts.technicians.back().technician_id != technician_id) {
+            TechnicianLoad load;
+            load.technician_id = technician_id;
+            load.full_name = typed_query::column<std::string>(technicians, 1);
+            counts.technicians.push_back(std::move(load));
+        }
+        auto status = typed_query::column<ServiceStatus>(technicians, 2);
+        if (size_t(status) < SERVICE_STATUS_COUNT) {
+            counts.technicians.back().by_status[size_t(status)] = sqlite3_column_int(technicians, 3);
+        }
+    }
+    exec_in(db, "RELEASE service_counts;", "get_service_counts");
+    return counts;
+}
+
+bool add_timeline_entry(int service_id, int user_id, const std::string &note,
+                        std::optional<ServiceStatus> status, sqlite3 *db) {
+    TraceScope trace("add_timeline_entry");
+    CachedStmt stmt(db, sql::insert_history);
+    if (!stmt) {
+        std::cerr << "add_timeline_entry prepare failed: " << sqlite3_errmsg(db) << "\n";
         return false;
     }
-    sqlite3_bind_text(stmt, 1, client_name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, client_phone.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, client_email.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, equipment_desc.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 5, problem_report.c_str(), -1, SQLITE_TRANSIENT);
+    std::optional<int> user;
+    std::optional<std::string_view> note_text;
+    if (user_id > 0) user = user_id;
+    if (!note.empty()) note_text = note;
+    bind_args(stmt, service_id, user, note_text, status);
 
-    bool ok = true;
     if (sqlite3_step(stmt) != SQLITE_DONE) {
-        std::cerr << "add_service step error: " << sqlite3_errmsg(db) << "\n";
-        ok = false;
+        std::cerr << "add_timeline_entry step error: " << sqlite3_errmsg(db) << "\n";
+        return false;
     }
-    sqlite3_finalize(stmt);
-    return ok;
+    return true;
+}
+
+TimelinePage get_timeline_page(int service_id, const std::optional<TimelineCursor> &after,
+                               int page_size, sqlite3 *db) {
+    TraceScope trace("get_timeline_page");
+    TimelinePage page;
+    CachedStmt stmt(db, after ? sql::timeline_page_after : sql::timeline_page);
+    if (!stmt) {
+        std::cerr << "get_timeline_page prepare failed: " << sqlite3_errmsg(db) << "\n";
+        return page;
+    }
+    // one extra row tells us whether another page exists
+    int limit = page_size + 1;
+    if (after) bind_args(stmt, service_id, after->created_at, after->history_id, limit);
+    else bind_args(stmt, service_id, limit);
+
+    page.entries.reserve(page_size);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if ((int)page.entries.size() == page_size) {
+            const auto &last = page.entries.back();
+            page.next = TimelineCursor{last.created_at, last.history_id};
+            break;
+        }
+        TimelineColumns::read_into(stmt, page.entries.emplace_back());
+    }
+    trace.rows(page.entries.size());
+    return page;
+}
+
+std::optional<TimelineEntry> get_timeline_entry(int history_id, sqlite3 *db) {
+    TraceScope trace("get_timeline_entry");
+    CachedStmt stmt(db, sql::timeline_entry);
+    if (!stmt) {
+        std::cerr << "get_timeline_entry prepare failed: " << sqlite3_errmsg(db) << "\n";
+        return std::nullopt;
+    }
+    bind_args(stmt, history_id);
+    if (sqlite3_step(stmt) == SQLITE_ROW) return TimelineColumns::read(stmt);
+    return std::nullopt;
 }
 
 bool assign_technician(int technician_id, int service_id) {
-    const char *sql =
-        "INSERT INTO service_technicians (service_id, technician_id) "
-        "VALUES (?, ?);";
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    TraceScope trace("assign_technician");
+    CachedStmt stmt(db, sql::assign_technician);
+    if (!stmt) {
         std::cerr << "assign_technician prepare failed: " << sqlite3_errmsg(db) << "\n";
         return false;
     }
-    sqlite3_bind_int(stmt, 1,service_id);
-    sqlite3_bind_int(stmt, 2, technician_id);
+    bind_args(stmt, service_id, technician_id);
 
-    bool ok = true;
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         std::cerr << "assign_technician step error: " << sqlite3_errmsg(db) << "\n";
-        ok = false;
+        return false;
     }
-    sqlite3_finalize(stmt);
-    return ok;
-    }
\ No newline at end of file
+    return true;
+    }
+
+std::optional<std::pair<int, int>> get_assignment(sqlite3_int64 rowid, sqlite3 *db) {
+    TraceScope trace("get_assignment");
+    CachedStmt stmt(db, sql::assignment_by_rowid);
+    if (!stmt) {
+        std::cerr << "get_assignment prepare failed: " << sqlite3_errmsg(db) << "\n";
+        return std::nullopt;
+    }
+    bind_args(stmt, rowid);
+    if (sqlite3_step(stmt) != SQLITE_ROW) return std::nullopt;
+    return std::make_pair(typed_query::column<int>(stmt, 0), typed_query::column<int>(stmt, 1));
+}
+
+// A plan line such as "SCAN users" means a full pass over the table. Index
+// scans ("SCAN s USING INDEX ...") walk rows in index order and are fine;
+// virtual tables plan their own access.
+static bool is_table_scan(std::string_view detail) {
+    return detail.rfind("SCAN ", 0) == 0
+        && detail.find(" USING ") == std::string::npos
+        && detail.find(" VIRTUAL TABLE ") == std::string::npos;
+}
+
+std::vector<std::string> unindexed_scans(sqlite3 *db) {
+    std::vector<std::string> out;
+    std::vector<const char*> queries(std::begin(sql::all), std::end(sql::all));
+    if (search_available(db)) queries.push_back(sql::search_services);
+
+    for (const char *query : queries) {
+        sqlite3_stmt *stmt = nullptr;
+        std::string explain = std::string("EXPLAIN QUERY PLAN ") + query;
+        if (sqlite3_prepare_v2(db, explain.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            out.push_back(std::string(query) + " -> " + sqlite3_errmsg(db));
+            sqlite3_finalize(stmt);
+            continue;
+        }
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            auto detail = typed_query::column<std::string_view>(stmt, 3);
+            if (is_table_scan(detail)) out.push_back(std::string(query) + " -> " + std::string(detail));
+        }
+        sqlite3_finalize(stmt);
+    }
+    return out;
+}
@@ -0,0 +1,127 @@
+#include "../include/db_executor.h"
+#include "../include/change_feed.h"
+#include "../include/connection_pool.h"
+#include <iostream>
+
+DbExecutor::DbExecutor(sqlite3 *db_, Poster post_to_ui_, ConnectionPool *readers_)
+: db(db_), post_to_ui(std::move(post_to_ui_)), readers(readers_)
+{
+    if (readers && readers->size() == 0) readers = nullptr;
+    writer = std::thread(&DbExecutor::writer_loop, this);
+    if (readers) {
+        for (size_t i = 0; i < readers->size(); i++) {
+            reader_threads.emplace_back(&DbExecutor::reader_loop, this);
+        }
+    }
+}
+
+DbExecutor::~DbExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    read_cv.notify_all();
+    writer.join();
+    for (auto &t : reader_threads) t.join();
+}
+
+void DbExecutor::attach(ChangeFeed *feed_) {
+    std::lock_guard<std::mutex> lock(mutex);
+    feed = feed_;
+}
+
+void DbExecutor::enqueue(Kind kind, Job job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (kind == Kind::Read && readers) {
+            read_queue.push_back(std::move(job));
+        } else {
+            queue.push_back(Task{kind == Kind::Write, std::move(job)});
+        }
+    }
+    if (kind == Kind::Read && readers) read_cv.notify_one();
+    else cv.notify_one();
+}
+
+void DbExecutor::post(Completion completion) {
+    if (completion) post_to_ui(std::move(completion));
+}
+
+void DbExecutor::flush_changes() {
+    ChangeFeed *changes;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        changes = feed;
+    }
+    if (changes) changes->flush();
+}
+
+static bool exec_or_log(sqlite3 *db, const char *sql) {
+    char *err_msg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "DbExecutor: " << sql << " failed: " << err_msg << std::endl;
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+void DbExecutor::writer_loop() {
+    for (;;) {
+        std::deque<Task> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;   // stopping and drained
+            batch.swap(queue);
+        }
+
+        size_t i = 0;
+        while (i < batch.size()) {
+            size_t begin = i, end = i;
+            while (end < batch.size() && batch[end].write) end++;
+            // a run of two or more writes shares one transaction; if it
+            // cannot start, each write commits on its own instead
+            bool group = end - begin > 1 && sqlite3_get_autocommit(db)
+                      && exec_or_log(db, "BEGIN IMMEDIATE;");
+            std::vector<Completion> done;
+            // SQLite may roll the group back by itself, e.g. on SQLITE_FULL;
+            // the jobs after that point must not run outside of it
+            for (; i < end && !(group && sqlite3_get_autocommit(db)); i++) {
+                done.push_back(batch[i].job(db));
+            }
+            i = end;
+            if (group && (sqlite3_get_autocommit(db) || !exec_or_log(db, "COMMIT;"))) {
+                if (!sqlite3_get_autocommit(db)) exec_or_log(db, "ROLLBACK;");
+                // nothing of the group was kept, so its completions would
+                // report writes that never happened; run each job again on
+                // its own so every one carries its real result
+                done.clear();
+                for (size_t j = begin; j < end; j++) done.push_back(batch[j].job(db));
+            }
+            flush_changes();
+            for (auto &c : done) post(std::move(c));
+            if (i < batch.size() && !batch[i].write) {
+                Completion c = batch[i++].job(db);
+                flush_changes();
+                post(std::move(c));
+            }
+        }
+    }
+}
+
+void DbExecutor::reader_loop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            read_cv.wait(lock, [this] { return stopping || !read_queue.empty(); });
+            if (read_queue.empty()) return;
+            job = std::move(read_queue.front());
+            read_queue.pop_front();
+        }
+        auto lease = readers->acquire();
+        post(job(lease.get()));
+    }
+}
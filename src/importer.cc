@@ -0,0 +1,533 @@
+#include "../include/importer.h"
+#include "../include/db.h"
+#include "../include/json.h"
+#include "../include/stmt_cache.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Fields = std::vector<std::optional<std::string>>;
+
+// Column order of each import; Fields are indexed the same way.
+const std::vector<std::string> service_columns = {
+    "client_name", "client_phone", "client_email", "equipment_desc",
+    "problem_report", "created_by_id", "status", "created_at", "closed_at",
+};
+enum ServiceColumn { S_NAME, S_PHONE, S_EMAIL, S_EQUIPMENT, S_PROBLEM, S_CREATED_BY, S_STATUS, S_CREATED_AT, S_CLOSED_AT };
+
+const std::vector<std::string> user_columns = {
+    "full_name", "email", "username", "access_code_hash", "role_id", "role",
+};
+enum UserColumn { U_FULL_NAME, U_EMAIL, U_USERNAME, U_ACCESS_CODE, U_ROLE_ID, U_ROLE };
+
+const char insert_service_sql[] =
+    "INSERT INTO services (client_name, client_phone, client_email, equipment_desc, problem_report, "
+    "created_by_id, status, created_at, closed_at) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?, COALESCE(?, CAST(strftime('%s', 'now') AS INTEGER)), ?);";
+
+const char insert_user_sql[] =
+    "INSERT INTO users (full_name, email, username, access_code_hash, role_id) "
+    "VALUES (?, ?, ?, ?, ?);";
+
+int column_index(const std::vector<std::string> &columns, std::string_view name) {
+    auto it = std::find(columns.begin(), columns.end(), name);
+    return it == columns.end() ? -1 : int(it - columns.begin());
+}
+
+bool ends_with(const std::string &s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::optional<int> parse_int(const std::string &s) {
+    int value = 0;
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (ec != std::errc() || end != s.data() + s.size()) return std::nullopt;
+    return value;
+}
+
+// ---------------------------------------------------------------- CSV
+
+// RFC 4180 records: quoted fields may hold commas, doubled quotes and line
+// breaks, so one record can span several lines.
+class CsvReader {
+public:
+    explicit CsvReader(std::istream &in_) : in(in_) {}
+
+    // raw is the record's text without its final line break.
+    bool next(std::vector<std::string> &fields, std::string &raw, std::string &error) {
+        fields.clear();
+        raw.clear();
+        error.clear();
+        std::string line;
+        if (!std::getline(in, line)) return false;
+        this->line++;
+
+        std::string field;
+        bool quoted = false;
+        for (;;) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            raw += line;
+            for (size_t i = 0; i < line.size(); i++) {
+                char c = line[i];
+                if (quoted) {
+                    if (c != '"') field += c;
+                    else if (i + 1 < line.size() && line[i + 1] == '"') field += line[++i];
+                    else quoted = false;
+                } else if (c == '"') {
+                    quoted = true;
+                } else if (c == ',') {
+                    fields.push_back(std::move(field));
+                    field.clear();
+                } else {
+                    field += c;
+                }
+            }
+            if (!quoted) break;
+            if (!std::getline(in, line)) {
+                error = "unterminated quoted field";
+                break;
+            }
+            this->line++;
+            field += '\n';
+            raw += '\n';
+        }
+        fields.push_back(std::move(field));
+        return true;
+    }
+
+    size_t line = 0;
+
+private:
+    std::istream &in;
+};
+
+std::string csv_quote(const std::string &s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + '"';
+}
+
+// ---------------------------------------------------------------- JSONL
+
+void append_utf8(std::string &out, unsigned cp) {
+    if (cp < 0x80) {
+        out += char(cp);
+    } else if (cp < 0x800) {
+        out += char(0xC0 | (cp >> 6));
+        out += char(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += char(0xE0 | (cp >> 12));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    } else {
+        out += char(0xF0 | (cp >> 18));
+        out += char(0x80 | ((cp >> 12) & 0x3F));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    }
+}
+
+// Parser for one flat JSON object. Values may be strings, numbers, booleans
+// or null (stored as an empty optional); nested objects and arrays are
+// rejected since no column could hold them.
+class JsonLine {
+public:
+    explicit JsonLine(std::string_view text_) : text(text_) {}
+
+    bool parse(std::vector<std::pair<std::string, std::optional<std::string>>> &out, std::string &error) {
+        out.clear();
+        skip_space();
+        if (!eat('{')) return fail(error, "expected '{'");
+        skip_space();
+        if (eat('}')) return at_end(error);
+        for (;;) {
+            std::string key;
+            skip_space();
+            if (!string(key)) return fail(error, "expected a string key");
+            skip_space();
+            if (!eat(':')) return fail(error, "expected ':'");
+            skip_space();
+            std::optional<std::string> value;
+            if (!scalar(value)) return fail(error, "expected a string, number, boolean or null for \"" + key + "\"");
+            out.emplace_back(std::move(key), std::move(value));
+            skip_space();
+            if (eat('}')) return at_end(error);
+            if (!eat(',')) return fail(error, "expected ',' or '}'");
+        }
+    }
+
+private:
+    bool fail(std::string &error, const std::string &what) {
+        error = what + " at offset " + std::to_string(pos);
+        return false;
+    }
+
+    bool at_end(std::string &error) {
+        skip_space();
+        return pos == text.size() || fail(error, "trailing characters");
+    }
+
+    void skip_space() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) pos++;
+    }
+
+    bool eat(char c) {
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(std::string_view word) {
+        if (text.substr(pos, word.size()) != word) return false;
+        pos += word.size();
+        return true;
+    }
+
+    bool hex4(unsigned &cp) {
+        if (pos + 4 > text.size()) return false;
+        cp = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text[pos++];
+            cp <<= 4;
+            if (c >= '0' && c <= '9') cp |= c - '0';
+            else if (c >= 'a' && c <= 'f') cp |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') cp |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    bool string(std::string &out) {
+        if (!eat('"')) return false;
+        while (pos < text.size()) {
+            char c = text[pos++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos == text.size()) return false;
+            switch (text[pos++]) {
+                case '"':  out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/':  out += '/'; break;
+                case 'b':  out += '\b'; break;
+                case 'f':  out += '\f'; break;
+                case 'n':  out += '\n'; break;
+                case 'r':  out += '\r'; break;
+                case 't':  out += '\t'; break;
+                case 'u': {
+                    unsigned cp;
+                    if (!hex4(cp)) return false;
+                    if (cp >= 0xD800 && cp < 0xDC00) {
+                        unsigned low;
+                        if (!literal("\\u") || !hex4(low) || low < 0xDC00 || low >= 0xE000) return false;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, cp);
+                    break;
+                }
+                default: return false;
+            }
+        }
+        return false;
+    }
+
+    bool scalar(std::optional<std::string> &out) {
+        if (pos == text.size()) return false;
+        char c = text[pos];
+        if (c == '"') {
+            std::string s;
+            if (!string(s)) return false;
+            out = std::move(s);
+            return true;
+        }
+        if (literal("null")) return true;
+        if (literal("true")) { out = "1"; return true; }
+        if (literal("false")) { out = "0"; return true; }
+        size_t start = pos;
+        while (pos < text.size() && (isdigit((unsigned char)text[pos]) || std::string_view("+-.eE").find(text[pos]) != std::string_view::npos)) pos++;
+        if (pos == start) return false;
+        out = std::string(text.substr(start, pos - start));
+        return true;
+    }
+
+    std::string_view text;
+    size_t pos = 0;
+};
+
+// ---------------------------------------------------------------- rows
+
+void bind_optional(sqlite3_stmt *stmt, int idx, const std::optional<std::string> &value) {
+    if (value) sqlite3_bind_text(stmt, idx, value->c_str(), -1, SQLITE_STATIC);
+    else sqlite3_bind_null(stmt, idx);
+}
+
+bool bind_service(sqlite3_stmt *stmt, const Fields &f, const ImportOptions &options, std::string &error) {
+    if (!f[S_NAME] || f[S_NAME]->empty()) {
+        error = "client_name is required";
+        return false;
+    }
+    int created_by = options.default_created_by;
+    if (f[S_CREATED_BY] && !f[S_CREATED_BY]->empty()) {
+        auto id = parse_int(*f[S_CREATED_BY]);
+        if (!id) {
+            error = "created_by_id is not an integer: " + *f[S_CREATED_BY];
+            return false;
+        }
+        created_by = *id;
+    }
+    ServiceStatus status = ServiceStatus::Open;
+    if (f[S_STATUS] && !f[S_STATUS]->empty()) {
+        status = status_code(*f[S_STATUS]);
+        if (status == ServiceStatus::Unknown) {
+            error = "unknown status: " + *f[S_STATUS];
+            return false;
+        }
+    }
+    std::optional<sqlite3_int64> times[2];   // created_at, closed_at
+    for (int col : {S_CREATED_AT, S_CLOSED_AT}) {
+        if (!f[col] || f[col]->empty()) continue;
+        times[col - S_CREATED_AT] = parse_utc_time(*f[col]);
+        if (!times[col - S_CREATED_AT]) {
+            error = service_columns[col] + " is not a date: " + *f[col];
+            return false;
+        }
+    }
+    // a closed service always has closed_at, as edit_service() keeps it;
+    // without one it is taken to have closed when it was created
+    if (is_closed(status) && !times[1]) times[1] = times[0] ? *times[0] : sqlite3_int64(time(nullptr));
+
+    bind_optional(stmt, 1, f[S_NAME]);
+    bind_optional(stmt, 2, f[S_PHONE]);
+    bind_optional(stmt, 3, f[S_EMAIL]);
+    bind_optional(stmt, 4, f[S_EQUIPMENT]);
+    bind_optional(stmt, 5, f[S_PROBLEM]);
+    sqlite3_bind_int(stmt, 6, created_by);
+    sqlite3_bind_int(stmt, 7, int(status));
+    for (int i = 0; i < 2; i++) {
+        if (times[i]) sqlite3_bind_int64(stmt, 8 + i, *times[i]);
+        else sqlite3_bind_null(stmt, 8 + i);
+    }
+    return true;
+}
+
+bool bind_user(sqlite3_stmt *stmt, const Fields &f,
+               const std::unordered_map<std::string, int> &roles, std::string &error) {
+    for (int col : {U_FULL_NAME, U_USERNAME, U_ACCESS_CODE}) {
+        if (!f[col] || f[col]->empty()) {
+            error = user_columns[col] + " is required";
+            return false;
+        }
+    }
+    std::optional<int> role_id;
+    if (f[U_ROLE_ID] && !f[U_ROLE_ID]->empty()) {
+        role_id = parse_int(*f[U_ROLE_ID]);
+        if (!role_id) {
+            error = "role_id is not an integer: " + *f[U_ROLE_ID];
+            return false;
+        }
+    } else if (f[U_ROLE] && !f[U_ROLE]->empty()) {
+        auto it = roles.find(*f[U_ROLE]);
+        if (it == roles.end()) {
+            error = "unknown role: " + *f[U_ROLE];
+            return false;
+        }
+        role_id = it->second;
+    } else {
+        error = "role_id or role is required";
+        return false;
+    }
+
+    bind_optional(stmt, 1, f[U_FULL_NAME]);
+    // an empty email would collide with the UNIQUE constraint; store NULL
+    bind_optional(stmt, 2, f[U_EMAIL] && f[U_EMAIL]->empty() ? std::nullopt : f[U_EMAIL]);
+    bind_optional(stmt, 3, f[U_USERNAME]);
+    bind_optional(stmt, 4, f[U_ACCESS_CODE]);
+    sqlite3_bind_int(stmt, 5, *role_id);
+    return true;
+}
+
+std::unordered_map<std::string, int> load_roles(sqlite3 *db) {
+    std::unordered_map<std::string, int> roles;
+    CachedStmt stmt(db, "SELECT role_id, name FROM roles;");
+    if (!stmt) return roles;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        roles[reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1))] = sqlite3_column_int(stmt, 0);
+    }
+    return roles;
+}
+
+bool exec(sqlite3 *db, const char *sql, std::string *error = nullptr) {
+    char *err_msg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "import: " << sql << " failed: " << err_msg << std::endl;
+        if (error) *error = err_msg;
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+}
+
+ImportProgress import_file(ImportKind kind, const std::string &path,
+                           const ImportOptions &options, sqlite3 *db) {
+    ImportProgress progress;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        progress.error = "cannot open " + path;
+        std::cerr << "import: " << progress.error << std::endl;
+        return progress;
+    }
+    const bool jsonl = ends_with(path, ".jsonl") || ends_with(path, ".ndjson");
+    const auto &columns = kind == ImportKind::Services ? service_columns : user_columns;
+
+    std::ofstream rejects;
+    if (!options.reject_path.empty()) {
+        rejects.open(options.reject_path, std::ios::binary | std::ios::trunc);
+        if (!rejects) std::cerr << "import: cannot write rejects to " << options.reject_path << std::endl;
+    }
+
+    std::unordered_map<std::string, int> roles;
+    if (kind == ImportKind::Users) roles = load_roles(db);
+
+    // Held for the whole import, so every row reuses one prepared statement.
+    CachedStmt stmt(db, kind == ImportKind::Services ? insert_service_sql : insert_user_sql);
+    if (!stmt) {
+        progress.error = sqlite3_errmsg(db);
+        return progress;
+    }
+
+    CsvReader csv(in);
+    std::vector<int> slot_of;           // CSV column -> Fields index, or -1
+    std::string csv_header;
+    if (!jsonl) {
+        std::vector<std::string> header;
+        std::string error;
+        if (!csv.next(header, csv_header, error) || !error.empty()) {
+            progress.error = path + " has no header row";
+            std::cerr << "import: " << progress.error << std::endl;
+            return progress;
+        }
+        for (const auto &name : header) {
+            slot_of.push_back(column_index(columns, name));
+            if (slot_of.back() < 0) std::cerr << "import: ignoring unknown column " << name << std::endl;
+        }
+        if (rejects.is_open()) rejects << csv_header << ",reject_reason\n";
+    }
+
+    auto reject = [&](size_t line, const std::string &raw, const std::string &reason) {
+        progress.rejected++;
+        if (!rejects.is_open()) return;
+        if (jsonl) {
+            rejects << "{\"line\":" << line << ",\"reason\":" << json_string(reason)
+                    << ",\"record\":" << json_string(raw) << "}\n";
+        } else {
+            rejects << raw << ',' << csv_quote(reason) << '\n';
+        }
+    };
+
+    const bool defer_index = kind == ImportKind::Services && options.defer_search_index;
+    const bool defer_counts = kind == ImportKind::Services && options.defer_service_counts;
+    if (defer_index) suspend_search_index(db);
+    if (defer_counts) suspend_service_counts(db);
+    if (!exec(db, "BEGIN IMMEDIATE;", &progress.error)) {
+        progress.error = "BEGIN failed: " + progress.error;
+        if (defer_index) init_search_index(db);
+        if (defer_counts) init_service_counts(db);
+        return progress;
+    }
+    size_t in_batch = 0;
+    size_t batch_imported = 0;      // counted once the batch commits
+    size_t batch_line = 0;          // where the open batch starts
+    size_t json_line = 0;
+    // on failure nothing from batch_line on is in the database
+    auto commit = [&]() {
+        std::string why;
+        if (exec(db, "COMMIT;", &why)) {
+            progress.imported += batch_imported;
+            batch_imported = 0;
+            in_batch = 0;
+            return true;
+        }
+        if (!sqlite3_get_autocommit(db)) exec(db, "ROLLBACK;");
+        progress.error = "stopped at line " + std::to_string(batch_line) + ": COMMIT failed: " + why + "; the " +
+                         std::to_string(batch_imported) + " records of that batch were rolled back";
+        return false;
+    };
+    Fields fields(columns.size());
+    std::vector<std::string> values;
+    std::vector<std::pair<std::string, std::optional<std::string>>> pairs;
+    std::string raw, error;
+
+    for (;;) {
+        std::fill(fields.begin(), fields.end(), std::nullopt);
+        error.clear();
+        size_t line;
+        if (jsonl) {
+            if (!std::getline(in, raw)) break;
+            line = ++json_line;
+            if (!raw.empty() && raw.back() == '\r') raw.pop_back();
+            if (raw.find_first_not_of(" \t") == std::string::npos) continue;
+            if (JsonLine(raw).parse(pairs, error)) {
+                for (auto &[key, value] : pairs) {
+                    int slot = column_index(columns, key);
+                    if (slot >= 0) fields[slot] = std::move(value);
+                }
+            }
+        } else {
+            line = csv.line + 1;
+            if (!csv.next(values, raw, error)) break;
+            if (raw.empty()) continue;
+            if (error.empty() && values.size() != slot_of.size()) {
+                error = "expected " + std::to_string(slot_of.size()) + " fields, got " + std::to_string(values.size());
+            }
+            for (size_t i = 0; error.empty() && i < values.size(); i++) {
+                if (slot_of[i] >= 0) fields[slot_of[i]] = std::move(values[i]);
+            }
+        }
+        progress.read++;
+        if (in_batch == 0) batch_line = line;
+
+        if (error.empty()) {
+            bool bound = kind == ImportKind::Services
+                ? bind_service(stmt, fields, options, error)
+                : bind_user(stmt, fields, roles, error);
+            if (bound && sqlite3_step(stmt) != SQLITE_DONE) error = sqlite3_errmsg(db);
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+        }
+        if (error.empty()) batch_imported++;
+        else reject(line, raw, error);
+
+        if (++in_batch == options.batch_size) {
+            if (!commit()) break;
+            if (!exec(db, "BEGIN IMMEDIATE;", &progress.error)) {
+                progress.error = "stopped after line " + std::to_string(line) + ": BEGIN failed: " + progress.error;
+                break;
+            }
+            if (options.on_progress) options.on_progress(progress);
+        }
+    }
+
+    if (!sqlite3_get_autocommit(db)) commit();
+    if (defer_index) init_search_index(db);
+    if (defer_counts) init_service_counts(db);
+    if (options.on_progress) options.on_progress(progress);
+    return progress;
+}
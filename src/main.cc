@@ -1,11 +1,28 @@
 #include <gtkmm.h>
+#include <glib-unix.h>
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <deque>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <optional>
-#include <regex>
 #include <stack>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include "../include/main.h"
+#include "../include/change_feed.h"
+#include "../include/db_executor.h"
+#include "../include/connection_pool.h"
+#include "../include/importer.h"
+#include "../include/query_trace.h"
+#include "../include/service_list.h"
+#include "../include/service_repository.h"
+#include "../include/timeline_view.h"
 #include "gtkmm/alertdialog.h"
 #include "gtkmm/box.h"
 #include "gtkmm/button.h"
@@ -21,6 +38,102 @@ static void clear_container(Gtk::Box &box) {
     }
 }
 
+// "Sort by" choices for the service lists, in combo box order.
+static const std::pair<const char*, SortOrder> SORT_CHOICES[] = {
+    {"newest", SortOrder{}},
+    {"oldest", SortOrder{SortKey::Created, false}},
+    {"client", SortOrder{SortKey::Client, false}},
+    {"status", SortOrder{SortKey::Status, false}},
+    {"technician", SortOrder{SortKey::Technician, false}},
+};
+
+static Gtk::ComboBoxText *make_sort_combo(ServiceListView &list) {
+    auto combo = Gtk::make_managed<Gtk::ComboBoxText>();
+    for (const auto &choice : SORT_CHOICES) combo->append(choice.first);
+    combo->set_active(0);
+    list.model->set_order(SortOrder{});
+    combo->signal_changed().connect([&list, combo]() {
+        int row = combo->get_active_row_number();
+        if (row >= 0) list.model->set_order(SORT_CHOICES[row].second);
+    });
+    return combo;
+}
+
+// Local midnight at the start of the day "YYYY-MM-DD" plus add_days, or
+// nothing if text is not such a day.
+static std::optional<sqlite3_int64> local_day_start(const std::string &text, int add_days = 0) {
+    int year, month, day, used = 0;
+    if (sscanf(text.c_str(), "%4d-%2d-%2d%n", &year, &month, &day, &used) != 3 || used != 10
+        || text.size() != 10 || month < 1 || month > 12 || day < 1 || day > 31) {
+        return std::nullopt;
+    }
+    std::tm tm{};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_isdst = -1;
+    if (mktime(&tm) == -1 || tm.tm_mday != day) return std::nullopt;   // e.g. 31 April
+    tm.tm_mday += add_days;
+    tm.tm_isdst = -1;
+    return sqlite3_int64(mktime(&tm));
+}
+
+// The days typed into a pair of date entries, both included; an empty entry
+// leaves its end open. Nothing while either holds something else.
+static std::optional<TimeRange> day_range(const std::string &from, const std::string &to) {
+    TimeRange range;
+    if (!from.empty()) {
+        auto start = local_day_start(from);
+        if (!start) return std::nullopt;
+        range.from = *start;
+    }
+    if (!to.empty()) {
+        auto end = local_day_start(to, 1);
+        if (!end) return std::nullopt;
+        range.to = *end;
+    }
+    return range;
+}
+
+static constexpr size_t READ_CONNECTIONS = 2;
+// The dashboard's "recent" column counts the services created on this many
+// days, today included.
+static constexpr int DASHBOARD_RECENT_DAYS = 7;
+
+static DbConfig reader_config() {
+    DbConfig config;
+    config.read_only = true;
+    return config;
+}
+
+// Carries closures from the database threads back onto the GTK main loop.
+class UiQueue {
+public:
+    UiQueue() { dispatcher.connect(sigc::mem_fun(*this, &UiQueue::drain)); }
+
+    void post(std::function<void()> fn) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(std::move(fn));
+        }
+        dispatcher.emit();
+    }
+
+private:
+    void drain() {
+        std::deque<std::function<void()>> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.swap(pending);
+        }
+        for (auto &fn : ready) fn();
+    }
+
+    Glib::Dispatcher dispatcher;
+    std::mutex mutex;
+    std::deque<std::function<void()>> pending;
+};
+
 class AdminUserRow : public Gtk::Box {
 public:
     AdminUserRow(const UserRow& u, std::function<void(int)> on_edit, std::function<void(int)> on_delete)
@@ -46,18 +159,10 @@ public:
     UserRow user;
 };
 
-class ServiceRowWidget : public Gtk::Box {
+class ServiceRowWidget : public ServiceRowBase {
 public:
-    ServiceRowWidget(const ServiceRow& s, std::function<void(int)> on_edit, std::function<void(int)> on_delete)
-    : Gtk::Box(Gtk::Orientation::HORIZONTAL, 6), service(s)
+    ServiceRowWidget(std::function<void(int)> on_assign, std::function<void(int)> on_edit, std::function<void(int)> on_delete)
     {
-        get_style_context()->add_class("row");
-        
-        auto label = Gtk::make_managed<Gtk::Label>("#" + std::to_string(s.service_id) + "   " + s.client_name + "   " + s.status);
-        label->set_halign(Gtk::Align::START);
-        label->set_hexpand(true);
-        append(*label);
-        
         auto assign_btn = Gtk::make_managed<Gtk::Button>("Assign");
         assign_btn->get_style_context()->add_class("primary");
         auto edit_btn = Gtk::make_managed<Gtk::Button>("Edit");
@@ -70,124 +175,192 @@ public:
         append(*assign_btn);
         append(*edit_btn);
         append(*del_btn);
-        assign_btn->signal_clicked().connect([s, this] { on_assign_technician_clicked(s.service_id); });
-        edit_btn->signal_clicked().connect([on_edit, s] { on_edit(s.service_id); });
-        del_btn->signal_clicked().connect([on_delete, s] { on_delete(s.service_id); });
-    }
-    void on_assign_technician_clicked(int service_id) {
-        auto win = Gtk::make_managed<Gtk::Window>();
-        win->set_title("Assign Technician");
-        win->set_modal(true);
-        auto box = Gtk::make_managed<Gtk::Box>();
-        auto uv = get_users(db);
-        auto technicians_box = Gtk::make_managed<Gtk::ComboBoxText>();
-        for (auto &u: uv) {
-            if (u.role_id == 3) {
-                technicians_box->append(u.full_name);
-            }
-        }
-        auto confirm_assign_btn = Gtk::make_managed<Gtk::Button>("Confirm");
-
-        box->append(*technicians_box);
-        box->append(*confirm_assign_btn);
-
-        win->set_child(*box);
-
-        confirm_assign_btn->signal_clicked().connect([technicians_box, service_id, win](){
-            auto tech = get_user_by_name(technicians_box->get_active_text(), db);
-            assign_technician(tech->user_id, service_id);
-            std::cout << "assigned.\n";
-            win->close();
-        });
-
-        win->show();        
+        assign_btn->signal_clicked().connect([this, on_assign] { on_assign(service.service_id); });
+        edit_btn->signal_clicked().connect([this, on_edit] { on_edit(service.service_id); });
+        del_btn->signal_clicked().connect([this, on_delete] { on_delete(service.service_id); });
     }
-
-    ServiceRow service;
 };
 
-class ServiceHistoryRowWidget : public Gtk::Box {
+class ServiceHistoryRowWidget : public ServiceRowBase {
 public:
-    ServiceHistoryRowWidget(const ServiceRow& s, std::function<void(int)> on_edit)
-    : Gtk::Box(Gtk::Orientation::HORIZONTAL, 6), service(s)
+    ServiceHistoryRowWidget(std::function<void(int)> on_edit)
     {
-        get_style_context()->add_class("row");
-        
-        auto label = Gtk::make_managed<Gtk::Label>("#" + std::to_string(s.service_id) + "   " + s.client_name + "   " + s.status);
-        label->set_halign(Gtk::Align::START);
-        label->set_hexpand(true);
-        append(*label);
-        
         auto edit_btn = Gtk::make_managed<Gtk::Button>("Edit");
         edit_btn->get_style_context()->add_class("primary");
         append(*edit_btn);
 
-        edit_btn->signal_clicked().connect([on_edit, s] { on_edit(s.service_id); });
+        edit_btn->signal_clicked().connect([this, on_edit] { on_edit(service.service_id); });
     }
-    ServiceRow service;
 };
 
-class ChangeLogWidget : public Gtk::Box {
-public:
+// The pages of MyWindow's stack other than login. Each is built the first
+// time it is shown, so start-up only pays for the login screen.
+struct DashboardPage {
+    DashboardPage() {
+        box.set_margin(20);
+        box.get_style_context()->add_class("card");
+        title.get_style_context()->add_class("title");
+        for (Gtk::Button *btn : {&users_btn, &services_btn, &history_btn}) {
+            btn->get_style_context()->add_class("primary");
+        }
+        box.append(title);
+        box.append(users_btn);
+        box.append(services_btn);
+        box.append(history_btn);
+
+        // one row per status: all services, then those created recently
+        counts.set_column_spacing(16);
+        counts.set_row_spacing(2);
+        counts.attach(*Gtk::make_managed<Gtk::Label>("All"), 1, 0);
+        counts.attach(*Gtk::make_managed<Gtk::Label>("Last " + std::to_string(DASHBOARD_RECENT_DAYS) + " days"), 2, 0);
+        for (size_t i = 0; i < SERVICE_STATUS_COUNT; i++) {
+            auto name = Gtk::make_managed<Gtk::Label>(SERVICE_STATUS_NAMES[i]);
+            name->set_halign(Gtk::Align::START);
+            counts.attach(*name, 0, int(i) + 1);
+            counts.attach(totals[i], 1, int(i) + 1);
+            counts.attach(recent[i], 2, int(i) + 1);
+        }
+        for (Gtk::Label *label : {&counts_title, &workload_title}) {
+            label->get_style_context()->add_class("section-header");
+            label->set_halign(Gtk::Align::START);
+        }
+        box.append(counts_title);
+        box.append(counts);
+        box.append(workload_title);
+        box.append(workload);
+    }
 
-    ChangeLogWidget(const LogRow& l, std::function<void(int)> on_edit)
-    : Gtk::Box(Gtk::Orientation::HORIZONTAL, 6), log(l)
-    {
-        get_style_context()->add_class("row");
-        
-        auto label = Gtk::make_managed<Gtk::Label>("#" + std::to_string(l.service_id) + "   " + l.new_value + "   " + l.old_value);
-        label->set_halign(Gtk::Align::START);
-        label->set_hexpand(true);
-        append(*label);
-        
-        auto info_btn = Gtk::make_managed<Gtk::Button>("Info");
-        info_btn->get_style_context()->add_class("primary");
-        append(*info_btn);
+    Gtk::Box box{Gtk::Orientation::VERTICAL, 8};
+    Gtk::Label title{"Admin Dashboard"};
+    Gtk::Button users_btn{"Users"};
+    Gtk::Button services_btn{"Services"};
+    Gtk::Button history_btn{"History"};
+    // Filled by refresh_dashboard() whenever services or assignments change.
+    Gtk::Label counts_title{"Services"};
+    Gtk::Grid counts;
+    std::array<Gtk::Label, SERVICE_STATUS_COUNT> totals;
+    std::array<Gtk::Label, SERVICE_STATUS_COUNT> recent;
+    Gtk::Label workload_title{"Open services by technician"};
+    Gtk::Box workload{Gtk::Orientation::VERTICAL, 2};
+    bool loading = false;
+    bool stale = false;         // changed while loading, read again after
+};
 
-        info_btn->signal_clicked().connect([this, l]() {on_log_info_clicked(l.change_id);});
+// Filled by show_admin_users() each time it is opened.
+struct UsersPage {
+    UsersPage() {
+        scrolled.set_child(box);
+        scrolled.set_policy(Gtk::PolicyType::NEVER, Gtk::PolicyType::AUTOMATIC);
+        scrolled.set_propagate_natural_height(true);
+        box.set_margin(12);
+        title.get_style_context()->add_class("section-header");
     }
 
-    void on_log_info_clicked(int change_id) {
-        auto uopt = get_user_by_id(change_id, db);
-        if (!uopt) return;
-        
-        auto win = Gtk::make_managed<Gtk::Window>();
-        win->set_title("Info");
-        win->set_modal(true);
-        auto box = Gtk::make_managed<Gtk::Box>();
-        win->set_child(*box);
+    Gtk::ScrolledWindow scrolled;
+    Gtk::Box box{Gtk::Orientation::VERTICAL, 6};
+    Gtk::Label title{"Users"};
+};
 
-        win->show();
+// A title row, a filter row and a service list. The rows are filled by the
+// show_ function that opens the page.
+struct ServiceListPage {
+    ServiceListPage(const char *title_, std::function<ServiceRowBase*()> create_row)
+    : title(title_), list(std::move(create_row))
+    {
+        box.set_margin(12);
+        title.get_style_context()->add_class("section-header");
+        box_title.get_style_context()->add_class("admin-service-box-title");
+        box_subtitle.get_style_context()->add_class("admin-service-box-subtitle");
+        title.set_halign(Gtk::Align::START);
+        title.set_hexpand(true);
     }
 
-    LogRow log;
-
+    Gtk::Box box{Gtk::Orientation::VERTICAL, 20};
+    Gtk::Box box_title{Gtk::Orientation::HORIZONTAL, 6};
+    Gtk::Box box_subtitle{Gtk::Orientation::HORIZONTAL, 6};
+    Gtk::Label title;
+    ServiceListView list;
 };
 
+// Hidden page with the query_trace.h latencies, opened with Ctrl+Shift+D.
+struct DiagnosticsPage {
+    DiagnosticsPage() {
+        box.set_margin(12);
+        title.get_style_context()->add_class("section-header");
+        title.set_halign(Gtk::Align::START);
+        title.set_hexpand(true);
+        box_title.append(title);
+        box_title.append(refresh_btn);
+        close_btn.get_style_context()->add_class("flat");
+        box_title.append(close_btn);
+        text.set_editable(false);
+        text.set_monospace(true);
+        scrolled.set_child(text);
+        scrolled.set_vexpand(true);
+        box.append(box_title);
+        box.append(scrolled);
+    }
 
+    Gtk::Box box{Gtk::Orientation::VERTICAL, 6};
+    Gtk::Box box_title{Gtk::Orientation::HORIZONTAL, 6};
+    Gtk::Label title{"Diagnostics"};
+    Gtk::Button refresh_btn{"Refresh"};
+    Gtk::Button close_btn{"Return"};
+    Gtk::ScrolledWindow scrolled;
+    Gtk::TextView text;
+};
 
 class MyWindow : public Gtk::Window {
 public:
     MyWindow(sqlite3 *db);
 protected:
+    // Each builds its page and adds it to the stack on first use.
+    DashboardPage &dashboard_page();
+    void refresh_dashboard();
+    void show_dashboard_counts(const ServiceCounts &counts);
+    UsersPage &users_page();
+    ServiceListPage &services_page();
+    ServiceListPage &history_page();
+    ServiceListPage &technician_page();
+    DiagnosticsPage &diagnostics_page();
+    void build_page(const std::string &page_name);
+
     void navigate_to(const std::string& page_name);
     void on_return_clicked();
     void update_return_button_visibility();
 
     void on_login_clicked();
     void show_admin_users();
+    void apply_user_changes(const ChangeSet &changes);
+    void place_user_row(const UserRow &user);
     void on_add_user_clicked();
     void on_edit_user(int user_id);
+    void open_edit_user_dialog(const UserRow &user);
     void on_delete_user(int user_id);
 
     void show_admin_services();
     void on_add_service_clicked();
     void on_edit_service(int service_id);
+    void open_edit_service_dialog(const ServiceRow &srow);
     void on_delete_service(int service_id);
+    void on_assign_technician_clicked(int service_id);
 
     void show_history_services();
     void on_history_service_clicked(int service_id);
 
+    void show_diagnostics();
+    void refresh_diagnostics();
+    void close_diagnostics();
+
+    // Declared ahead of the widgets so the lists that subscribe to the
+    // repository are destroyed first.
+    sqlite3 *db;
+    UiQueue ui_queue;
+    ConnectionPool read_pool;
+    ChangeFeed change_feed;
+    DbExecutor executor;
+    ServiceRepository service_repository;
+
     Gtk::Stack stack;
 
     Gtk::Box login_box{Gtk::Orientation::VERTICAL, 8};
@@ -197,78 +370,44 @@ protected:
     Gtk::Button login_btn{"Login"};
     Gtk::Label login_msg{""};
 
-    Gtk::Box admin_box{Gtk::Orientation::VERTICAL, 8};
-    Gtk::Label admin_title{"Admin Dashboard"};
-    Gtk::Button admin_users_btn{"Users"};
-    Gtk::Button admin_services_btn{"Services"};
-    Gtk::Button admin_history_btn{"History"};
-
-    
-    Gtk::Box admin_users_box{Gtk::Orientation::VERTICAL, 6};
-    Gtk::Label admin_users_title{"Users"};
-    Gtk::ScrolledWindow admin_users_scrolled;
-
-    Gtk::Box admin_services_box{Gtk::Orientation::VERTICAL, 20};
-    Gtk::Box admin_services_list_box{Gtk::Orientation::VERTICAL, 6};
-    Gtk::Box admin_services_box_title{Gtk::Orientation::HORIZONTAL, 6};
-    Gtk::Box admin_services_box_subtitle{Gtk::Orientation::HORIZONTAL, 6};
-    Gtk::Label admin_services_title{"Services"};
-    Gtk::ScrolledWindow admin_services_scrolled; 
-
-    Gtk::Box admin_history_box{Gtk::Orientation::VERTICAL, 20};
-    Gtk::Box admin_history_list_box{Gtk::Orientation::VERTICAL, 6};
-    Gtk::Box admin_history_box_title{Gtk::Orientation::HORIZONTAL, 6};
-    Gtk::Box admin_history_box_subtitle{Gtk::Orientation::HORIZONTAL, 6};
-    Gtk::Label admin_history_title{"History"};
-    Gtk::ScrolledWindow admin_history_scrolled; 
-
-    Gtk::Box technician_services_box{Gtk::Orientation::VERTICAL, 20};
-    Gtk::Box technician_services_list_box{Gtk::Orientation::VERTICAL, 6};
-    Gtk::Box technician_services_box_title{Gtk::Orientation::HORIZONTAL, 6};
-    Gtk::Box technician_services_box_subtitle{Gtk::Orientation::HORIZONTAL, 6};
-    Gtk::Label technician_services_title{"services"};
-    Gtk::ScrolledWindow technician_services_scrolled; 
-
     Gtk::Button return_button{"Return"};
 
-    sqlite3 *db;
+    // Null until first shown. After the stack, so they leave it first.
+    std::unique_ptr<DashboardPage> dashboard;
+    std::unique_ptr<UsersPage> users;
+    std::unique_ptr<ServiceListPage> services;
+    std::unique_ptr<ServiceListPage> history;
+    std::unique_ptr<ServiceListPage> technician_services;
+    std::unique_ptr<DiagnosticsPage> diagnostics;
+
+    Gtk::Button *add_user_btn = nullptr;   // null until the users page is filled
+    std::unordered_map<int, AdminUserRow*> user_rows;
+
     int logged_in_user_id = 0;
+    int logged_in_role_id = 0;
     
     std::stack<std::string> navigation_stack;
     std::string current_page;
 };
 
-MyWindow::MyWindow(sqlite3 *db_) : db(db_) {
+MyWindow::MyWindow(sqlite3 *db_)
+: db(db_),
+  read_pool(sqlite3_db_filename(db_, "main"), READ_CONNECTIONS, reader_config()),
+  change_feed(db_, {"services", "users", "service_technicians", "service_history"},
+              [this](std::function<void()> fn) { ui_queue.post(std::move(fn)); }),
+  executor(db_, [this](std::function<void()> fn) { ui_queue.post(std::move(fn)); }, &read_pool),
+  service_repository(executor, change_feed)
+{
     set_default_size(700, 480);
     set_title("Service Desk");
     maximize();
     set_decorated(true);
 
-    admin_users_scrolled.set_child(admin_users_box);
-    admin_users_scrolled.set_policy(Gtk::PolicyType::NEVER, Gtk::PolicyType::AUTOMATIC);
-    admin_users_scrolled.set_propagate_natural_height(true);
-
-    admin_services_scrolled.set_child(admin_services_box);
-    admin_services_scrolled.set_policy(Gtk::PolicyType::NEVER, Gtk::PolicyType::AUTOMATIC);
-    admin_services_scrolled.set_propagate_natural_height(true);
-
-    admin_history_scrolled.set_child(admin_history_box);
-    admin_history_scrolled.set_policy(Gtk::PolicyType::NEVER, Gtk::PolicyType::AUTOMATIC);
-    admin_history_scrolled.set_propagate_natural_height(true);
-
-    technician_services_scrolled.set_child(technician_services_box);
-    technician_services_scrolled.set_policy(Gtk::PolicyType::NEVER, Gtk::PolicyType::AUTOMATIC);
-    technician_services_scrolled.set_propagate_natural_height(true);
-
     stack.add(login_box, "login");
-    stack.add(admin_box, "admin_users");
-    stack.add(admin_users_scrolled, "admin_users_list");      
-    stack.add(admin_services_scrolled, "admin_services_list");
-    stack.add(admin_history_scrolled, "admin_history_list");
-    stack.add(technician_services_scrolled, "technician_services_list");
-
     set_child(stack);
 
+    executor.attach(&change_feed);
+    change_feed.subscribe([this](const ChangeSet &changes) { apply_user_changes(changes); });
 
     login_box.set_margin(20);
     login_box.get_style_context()->add_class("card");
@@ -288,82 +427,151 @@ MyWindow::MyWindow(sqlite3 *db_) : db(db_) {
     login_box.append(login_msg);
     login_btn.signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::on_login_clicked));
 
-    admin_box.set_margin(20);
-    admin_box.get_style_context()->add_class("card");
-    
-    admin_title.get_style_context()->add_class("title");
-    admin_users_btn.get_style_context()->add_class("primary");
-    admin_services_btn.get_style_context()->add_class("primary");
-    admin_history_btn.get_style_context()->add_class("primary");
-    
-    admin_box.append(admin_title);
-    admin_box.append(admin_users_btn);
-    admin_box.append(admin_services_btn);
-    admin_box.append(admin_history_btn);
-    admin_users_btn.signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::show_admin_users));
-    admin_services_btn.signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::show_admin_services));
-    admin_history_btn.signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::show_history_services));
-
-    admin_users_box.set_margin(12);
-    admin_users_title.get_style_context()->add_class("section-header");
-    admin_users_box.append(admin_users_title);
-    
-    auto add_user_btn = Gtk::make_managed<Gtk::Button>("Add user");
-    add_user_btn->get_style_context()->add_class("success");
-    admin_users_box.append(*add_user_btn);
-    add_user_btn->signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::on_add_user_clicked));
-    
     return_button.get_style_context()->add_class("flat");
-    admin_users_box.append(return_button);
     return_button.signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::on_return_clicked));
 
-    admin_services_box.set_margin(12);
-    admin_services_title.get_style_context()->add_class("section-header");
-    admin_services_box_title.get_style_context()->add_class("admin-service-box-title");
-    admin_services_box_subtitle.get_style_context()->add_class("admin-service-box-subtitle");
+    auto keys = Gtk::EventControllerKey::create();
+    keys->signal_key_pressed().connect([this](guint keyval, guint, Gdk::ModifierType state) {
+        auto mods = Gdk::ModifierType::CONTROL_MASK | Gdk::ModifierType::SHIFT_MASK;
+        if ((state & mods) != mods || (keyval != GDK_KEY_D && keyval != GDK_KEY_d)) return false;
+        show_diagnostics();
+        return true;
+    }, false);
+    add_controller(keys);
 
-      // admin_services_list_box.get_style_context()->add_class("admin-service-box-subtitle");
-    admin_services_title.set_halign(Gtk::Align::START);
-    admin_services_title.set_hexpand(true);
 
-    admin_services_box_title.append(admin_services_title);
-    auto add_service_btn = Gtk::make_managed<Gtk::Button>("Add Service >");
-    add_service_btn->set_halign(Gtk::Align::END);
+    stack.set_visible_child("login");
+    current_page = "login";
+    update_return_button_visibility();
+}
 
-    admin_services_box_title.append(*add_service_btn);
+DashboardPage &MyWindow::dashboard_page() {
+    if (dashboard) return *dashboard;
+    dashboard = std::make_unique<DashboardPage>();
+    dashboard->users_btn.signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::show_admin_users));
+    dashboard->services_btn.signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::show_admin_services));
+    dashboard->history_btn.signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::show_history_services));
+    stack.add(dashboard->box, "admin_users");
+    // the counts are a few rows kept by triggers, so reading them again on
+    // every change costs no more than keeping them up to date here would
+    change_feed.subscribe([this](const ChangeSet &changes) {
+        for (const auto &c : changes) {
+            if (c.table == "services" || c.table == "service_technicians" || c.table == "users") {
+                refresh_dashboard();
+                return;
+            }
+        }
+    });
+    refresh_dashboard();
+    return *dashboard;
+}
 
-    admin_services_box.append(admin_services_box_title);
-    admin_services_box.append(admin_services_box_subtitle);
-    
+// At most one read in flight; changes that arrive meanwhile fold into one
+// more read once it is done.
+void MyWindow::refresh_dashboard() {
+    if (dashboard->loading) {
+        dashboard->stale = true;
+        return;
+    }
+    dashboard->loading = true;
+    executor.run_read([](sqlite3 *db) {
+        return get_service_counts(DASHBOARD_RECENT_DAYS, db);
+    }, [this](ServiceCounts counts) {
+        dashboard->loading = false;
+        show_dashboard_counts(counts);
+        if (dashboard->stale) {
+            dashboard->stale = false;
+            refresh_dashboard();
+        }
+    });
+}
 
-    add_service_btn->get_style_context()->add_class("success");
-    add_service_btn->signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::on_add_service_clicked));
+void MyWindow::show_dashboard_counts(const ServiceCounts &counts) {
+    for (size_t i = 0; i < SERVICE_STATUS_COUNT; i++) {
+        dashboard->totals[i].set_text(std::to_string(counts.by_status[i]));
+        dashboard->recent[i].set_text(std::to_string(counts.recent[i]));
+    }
+    clear_container(dashboard->workload);
+    for (const auto &t : counts.technicians) {
+        int open = 0;
+        for (size_t i = 0; i < SERVICE_STATUS_COUNT; i++) {
+            if (!is_closed(ServiceStatus(i))) open += t.by_status[i];
+        }
+        if (open == 0) continue;
+        std::string name = t.technician_id == 0 ? "Unassigned" : t.full_name;
+        auto label = Gtk::make_managed<Gtk::Label>(name + ": " + std::to_string(open));
+        label->set_halign(Gtk::Align::START);
+        dashboard->workload.append(*label);
+    }
+}
 
+UsersPage &MyWindow::users_page() {
+    if (users) return *users;
+    users = std::make_unique<UsersPage>();
+    stack.add(users->scrolled, "admin_users_list");
+    return *users;
+}
 
-    admin_history_box.set_margin(12);
-    admin_history_title.get_style_context()->add_class("section-header");
-    admin_history_box_title.get_style_context()->add_class("admin-service-box-title");
-    admin_history_box_subtitle.get_style_context()->add_class("admin-service-box-subtitle");
-    admin_history_title.set_halign(Gtk::Align::START);
-    admin_history_title.set_hexpand(true);
+ServiceListPage &MyWindow::services_page() {
+    if (services) return *services;
+    services = std::make_unique<ServiceListPage>("Services", [this] {
+        return Gtk::make_managed<ServiceRowWidget>(
+            [this](int id){ on_assign_technician_clicked(id); },
+            [this](int id){ on_edit_service(id); },
+            [this](int id){ on_delete_service(id); });
+    });
+    services->list.set_repository(&service_repository);
+    stack.add(services->box, "admin_services_list");
+    return *services;
+}
 
-    technician_services_box.set_margin(12);
-    technician_services_title.get_style_context()->add_class("section-header");
-    technician_services_box_title.get_style_context()->add_class("admin-service-box-title");
-    technician_services_box_subtitle.get_style_context()->add_class("admin-service-box-subtitle");
-    technician_services_title.set_halign(Gtk::Align::START);
-    technician_services_title.set_hexpand(true);
+ServiceListPage &MyWindow::history_page() {
+    if (history) return *history;
+    history = std::make_unique<ServiceListPage>("History", [this] {
+        return Gtk::make_managed<ServiceHistoryRowWidget>(
+            [this](int id){ on_edit_service(id); });
+    });
+    history->list.set_repository(&service_repository);
+    stack.add(history->box, "admin_history_list");
+    return *history;
+}
 
+ServiceListPage &MyWindow::technician_page() {
+    if (technician_services) return *technician_services;
+    technician_services = std::make_unique<ServiceListPage>("services", [this] {
+        return Gtk::make_managed<ServiceRowWidget>(
+            [this](int id){ on_assign_technician_clicked(id); },
+            [this](int id){ on_edit_service(id); },
+            [this](int id){ on_delete_service(id); });
+    });
+    technician_services->list.set_repository(&service_repository);
+    stack.add(technician_services->box, "technician_services_list");
+    return *technician_services;
+}
 
-    stack.set_visible_child("login");
-    current_page = "login";
-    update_return_button_visibility();
+DiagnosticsPage &MyWindow::diagnostics_page() {
+    if (diagnostics) return *diagnostics;
+    diagnostics = std::make_unique<DiagnosticsPage>();
+    diagnostics->refresh_btn.signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::refresh_diagnostics));
+    diagnostics->close_btn.signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::close_diagnostics));
+    stack.add(diagnostics->box, "diagnostics");
+    return *diagnostics;
+}
+
+void MyWindow::build_page(const std::string &page_name) {
+    if (page_name == "admin_users") dashboard_page();
+    else if (page_name == "admin_users_list") users_page();
+    else if (page_name == "admin_services_list") services_page();
+    else if (page_name == "admin_history_list") history_page();
+    else if (page_name == "technician_services_list") technician_page();
+    else if (page_name == "diagnostics") diagnostics_page();
 }
 
 void MyWindow::navigate_to(const std::string& page_name) {
     if (current_page != "login") {
         navigation_stack.push(current_page);
     }
+    build_page(page_name);
     current_page = page_name;
     stack.set_visible_child(page_name);
     update_return_button_visibility();
@@ -390,76 +598,178 @@ void MyWindow::update_return_button_visibility() {
     }
 
     if (should_show && !return_button.get_parent()) {
-        auto us = get_user_by_id(logged_in_user_id,  db);
-        if (us->role_id != 1) return;
+        if (logged_in_role_id != 1) return;
         if (current_page == "admin_users_list") {
-            admin_users_box.append(return_button);
+            users_page().box.append(return_button);
         } else if (current_page == "admin_services_list") {
-            admin_services_box.append(return_button);
+            services_page().box.append(return_button);
         } else if (current_page == "admin_history_list") {
-            admin_history_box.append(return_button);
+            history_page().box.append(return_button);
         }
     }
     return_button.set_visible(should_show);
 }
 
-void MyWindow::on_login_clicked() {
-    auto user = login_user.get_text();
-    auto pass = login_pass.get_text();
-    login_msg.set_text("");
-    auto uid_opt = try_login(user, pass);
-    if (!uid_opt) {
-        login_msg.set_text("Invalid credentials");
+void MyWindow::show_diagnostics() {
+    refresh_diagnostics();
+    if (current_page == "diagnostics") return;
+    // navigate_to() never pushes the login page, so remember it here
+    if (current_page == "login") {
+        build_page("diagnostics");
+        current_page = "diagnostics";
+        stack.set_visible_child("diagnostics");
         return;
     }
-    logged_in_user_id = uid_opt->user_id;
+    navigate_to("diagnostics");
+}
 
-    while (!navigation_stack.empty()) {
-        navigation_stack.pop();
+void MyWindow::close_diagnostics() {
+    if (!navigation_stack.empty()) {
+        on_return_clicked();
+        return;
     }
+    current_page = "login";
+    stack.set_visible_child("login");
+}
 
-    if (uid_opt->role_id == 1) {
-        current_page = "admin_users";
-        stack.set_visible_child("admin_users");
-        update_return_button_visibility();
-    } else if (uid_opt->role_id == 2) {
-        show_admin_services();
-    } else {
-        std::vector<ServiceRow> sv = get_services(db, logged_in_user_id);
-        clear_container(technician_services_box);
-        
-        technician_services_box.append(technician_services_box_title);
-        
-        for (auto &s: sv) {
-            auto w = Gtk::make_managed<ServiceRowWidget>(s,
-                [this](int id){ on_edit_service(id); },
-                [this](int id){ on_delete_service(id); });
-            technician_services_box.append(*w);
-        }
-        navigate_to("technician_services_list");
+// One line per traced call and statement, most total time first.
+void MyWindow::refresh_diagnostics() {
+    std::string text;
+    char line[160];
+    snprintf(line, sizeof line, "%-9s %10s %10s %10s %10s %10s %12s  %s\n",
+             "kind", "count", "rows", "p50 us", "p95 us", "p99 us", "total ms", "name");
+    text += line;
+    for (const auto &s : trace_snapshot()) {
+        snprintf(line, sizeof line, "%-9s %10llu %10llu %10.1f %10.1f %10.1f %12.3f  ",
+                 s.statement ? "statement" : "call",
+                 (unsigned long long)s.count, (unsigned long long)s.rows,
+                 s.p50_us, s.p95_us, s.p99_us, s.total_ms);
+        text += line;
+        text += s.name;
+        text += "\n";
     }
+    diagnostics_page().text.get_buffer()->set_text(text);
+}
+
+void MyWindow::on_login_clicked() {
+    std::string user = login_user.get_text();
+    std::string pass = login_pass.get_text();
+    login_msg.set_text("");
+    login_btn.set_sensitive(false);
+    executor.run([user, pass](sqlite3 *) { return try_login(user, pass); },
+                 [this](std::optional<LoginResult> uid_opt) {
+        login_btn.set_sensitive(true);
+        if (!uid_opt) {
+            login_msg.set_text("Invalid credentials");
+            return;
+        }
+        logged_in_user_id = uid_opt->user_id;
+        logged_in_role_id = uid_opt->role_id;
+
+        while (!navigation_stack.empty()) {
+            navigation_stack.pop();
+        }
+
+        if (uid_opt->role_id == 1) {
+            build_page("admin_users");
+            current_page = "admin_users";
+            stack.set_visible_child("admin_users");
+            update_return_button_visibility();
+        } else if (uid_opt->role_id == 2) {
+            show_admin_services();
+        } else {
+            ServiceListPage &page = technician_page();
+            clear_container(page.box);
+            
+            page.box.append(page.box_title);
+            page.box.append(page.list);
+            page.list.load(&executor, logged_in_user_id);
+            navigate_to("technician_services_list");
+        }
+    });
 }
 
 void MyWindow::show_admin_users() {
-    clear_container(admin_users_box);
-    admin_users_box.append(admin_users_title);
-    
-    auto add_user_btn = Gtk::make_managed<Gtk::Button>("Add user");
-    add_user_btn->get_style_context()->add_class("success");
-    admin_users_box.append(*add_user_btn);
-    add_user_btn->signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::on_add_user_clicked));
-
-    auto users = get_users(db);
-    for (auto &u: users) {
-        auto row = Gtk::make_managed<AdminUserRow>(u,
-            [this](int id){ on_edit_user(id); },
-            [this](int id){ on_delete_user(id); });
-        admin_users_box.append(*row);
-    }
+    executor.run_read([](sqlite3 *db) { return get_users(db); },
+                 [this](std::vector<UserRow> users) {
+        UsersPage &page = users_page();
+        clear_container(page.box);
+        user_rows.clear();
+        page.box.append(page.title);
+        
+        add_user_btn = Gtk::make_managed<Gtk::Button>("Add user");
+        add_user_btn->get_style_context()->add_class("success");
+        page.box.append(*add_user_btn);
+        add_user_btn->signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::on_add_user_clicked));
+
+        for (auto &u: users) {
+            auto row = Gtk::make_managed<AdminUserRow>(u,
+                [this](int id){ on_edit_user(id); },
+                [this](int id){ on_delete_user(id); });
+            page.box.append(*row);
+            user_rows[u.user_id] = row;
+        }
+        // keep the return button below the rows
+        update_return_button_visibility();
+    });
     
     navigate_to("admin_users_list");
 }
 
+// Patches the users page with the rows a transaction changed, so adding or
+// editing one user does not rebuild the whole list.
+void MyWindow::apply_user_changes(const ChangeSet &changes) {
+    if (!add_user_btn) return;   // the page is built fresh when it is opened
+    std::vector<int> changed;
+    for (const auto &c : changes) {
+        if (c.table != "users") continue;
+        int user_id = int(c.rowid);
+        if (c.op != ChangeOp::Delete) {
+            changed.push_back(user_id);
+            continue;
+        }
+        auto it = user_rows.find(user_id);
+        if (it != user_rows.end()) {
+            users_page().box.remove(*it->second);
+            user_rows.erase(it);
+        }
+    }
+    if (changed.empty()) return;
+    executor.run_read([changed](sqlite3 *db) {
+        std::vector<UserRow> users;
+        for (int user_id : changed) {
+            if (auto u = get_user_by_id(user_id, db)) users.push_back(std::move(*u));
+        }
+        return users;
+    }, [this](std::vector<UserRow> users) {
+        if (!add_user_btn) return;
+        for (const auto &u : users) place_user_row(u);
+    });
+}
+
+// Replaces or inserts the row for one user, keeping the list in username order.
+void MyWindow::place_user_row(const UserRow &user) {
+    auto old = user_rows.find(user.user_id);
+    if (old != user_rows.end()) {
+        users_page().box.remove(*old->second);
+        user_rows.erase(old);
+    }
+    Gtk::Widget *after = add_user_btn;
+    const std::string *after_name = nullptr;
+    for (auto &[id, row] : user_rows) {
+        const std::string &name = row->user.username;
+        if (name < user.username && (!after_name || *after_name < name)) {
+            after = row;
+            after_name = &name;
+        }
+    }
+    auto row = Gtk::make_managed<AdminUserRow>(user,
+        [this](int id){ on_edit_user(id); },
+        [this](int id){ on_delete_user(id); });
+    users_page().box.insert_child_after(*row, *after);
+    user_rows[user.user_id] = row;
+}
+
 void MyWindow::on_add_user_clicked() {
     auto win = Gtk::make_managed<Gtk::Window>();
     win->set_title("Add user");
@@ -513,16 +823,19 @@ void MyWindow::on_add_user_clicked() {
         std::string pass = e_pass->get_text();
         int role = role_combo->get_active_row_number() + 1;
         std::cout << "adding user\n";
-        if (add_user(full, email, username, pass, role, db)) {
-            std::cout << "added user\n";
-            show_admin_users();
-            win->hide();
-        } else {
-            std::cout << "failed user\n";
-            Gtk::MessageDialog err(*this, "Failed to add user", false, Gtk::MessageType::ERROR);
-            err.set_modal(true);
-            err.show();
-        }
+        executor.run_write([full, email, username, pass, role](sqlite3 *db) {
+            return add_user(full, email, username, pass, role, db);
+        }, [this, win](bool ok) {
+            if (ok) {
+                std::cout << "added user\n";
+                win->hide();
+            } else {
+                std::cout << "failed user\n";
+                Gtk::MessageDialog err(*this, "Failed to add user", false, Gtk::MessageType::ERROR);
+                err.set_modal(true);
+                err.show();
+            }
+        });
     });
     
     cancel_btn->signal_clicked().connect([win]() { win->hide(); });
@@ -531,9 +844,13 @@ void MyWindow::on_add_user_clicked() {
 }
 
 void MyWindow::on_edit_user(int user_id) {
-    auto uopt = get_user_by_id(user_id, db);
-    if (!uopt) return;
-    
+    executor.run_read([user_id](sqlite3 *db) { return get_user_by_id(user_id, db); },
+                 [this](std::optional<UserRow> uopt) {
+        if (uopt) open_edit_user_dialog(*uopt);
+    });
+}
+
+void MyWindow::open_edit_user_dialog(const UserRow &user) {
     auto win = Gtk::make_managed<Gtk::Window>();
     win->set_title("Edit user");
     win->set_modal(true);
@@ -552,11 +869,11 @@ void MyWindow::on_edit_user(int user_id) {
     role_combo->append("admin"); 
     role_combo->append("commercial"); 
     role_combo->append("technician");
-    role_combo->set_active(uopt->role_id - 1);
+    role_combo->set_active(user.role_id - 1);
 
-    e_user->set_text(uopt->username);
-    e_full->set_text(uopt->full_name);
-    e_email->set_text(uopt->email);
+    e_user->set_text(user.username);
+    e_full->set_text(user.full_name);
+    e_email->set_text(user.email);
 
     box->append(*e_full);
     box->append(*e_email);
@@ -575,23 +892,26 @@ void MyWindow::on_edit_user(int user_id) {
     btn_box->append(*cancel_btn);
     btn_box->append(*save_btn);
     box->append(*btn_box);
-    int id = uopt->user_id;
+    int id = user.user_id;
 
     save_btn->signal_clicked().connect([this, id, e_full, e_email, e_user, role_combo, win]() {
         std::string full = e_full->get_text();
         std::string email = e_email->get_text();
         std::string username = e_user->get_text();
         int role = role_combo->get_active_row_number() + 1;
-        if (edit_user(id, full, email, username, role, db)) {
-            std::cout << "edited user\n";
-            show_admin_users();
-            win->hide();
-        } else {
-            std::cout << "failed to edit user\n";
-            Gtk::MessageDialog err(*this, "Failed to edit user", false, Gtk::MessageType::ERROR);
-            err.set_modal(true);
-            err.show();
-        }
+        executor.run_write([id, full, email, username, role](sqlite3 *db) {
+            return edit_user(id, full, email, username, role, db);
+        }, [this, win](bool ok) {
+            if (ok) {
+                std::cout << "edited user\n";
+                win->hide();
+            } else {
+                std::cout << "failed to edit user\n";
+                Gtk::MessageDialog err(*this, "Failed to edit user", false, Gtk::MessageType::ERROR);
+                err.set_modal(true);
+                err.show();
+            }
+        });
     });
     
     cancel_btn->signal_clicked().connect([win]() { win->hide(); });
@@ -607,13 +927,14 @@ void MyWindow::on_delete_user(int user_id) {
         try {
             int response = confirm_dialog->choose_finish(result);
             if (response == 1) {
-                if (!delete_user(user_id, db)) {
-                    auto error_dialog = Gtk::AlertDialog::create("Failed to delete user");
-                    error_dialog->set_buttons({ "OK" });
-                    error_dialog->show(*this);
-                } else {
-                    show_admin_users();
-                }
+                executor.run_write([user_id](sqlite3 *db) { return delete_user(user_id, db); },
+                                   [this](bool ok) {
+                    if (!ok) {
+                        auto error_dialog = Gtk::AlertDialog::create("Failed to delete user");
+                        error_dialog->set_buttons({ "OK" });
+                        error_dialog->show(*this);
+                    }
+                });
             }
         } catch (const Glib::Error& e) {
         }
@@ -621,142 +942,105 @@ void MyWindow::on_delete_user(int user_id) {
 }
 
 void MyWindow::show_admin_services() {
-    clear_container(admin_services_box);
-    clear_container(admin_services_box_title);
-    clear_container(admin_services_box_subtitle);
-    clear_container(admin_services_list_box);
+    ServiceListPage &page = services_page();
+    clear_container(page.box);
+    clear_container(page.box_title);
+    clear_container(page.box_subtitle);
 
     auto filter_status = Gtk::make_managed<Gtk::ComboBoxText>();
-
-    auto services = std::make_shared<std::vector<ServiceRow>>();
-    
     
-    filter_status->append("all"); 
-    filter_status->append("open"); 
-    filter_status->append("closed"); 
-    filter_status->append("waiting technician");
+    filter_status->append("all");
+    for (const char *name : SERVICE_STATUS_NAMES) filter_status->append(name);
     filter_status->set_active(0);
     auto filter_label = Gtk::make_managed<Gtk::Label>("Filter by: ");
     auto filter_entry = Gtk::make_managed<Gtk::Entry>();
     
 
-    admin_services_box_subtitle.append(*filter_label);
-    admin_services_box_subtitle.append(*filter_entry);
-    admin_services_box_subtitle.append(*filter_status);
+    page.box_subtitle.append(*filter_label);
+    page.box_subtitle.append(*filter_entry);
+    page.box_subtitle.append(*filter_status);
+    page.box_subtitle.append(*Gtk::make_managed<Gtk::Label>("Sort by: "));
+    page.box_subtitle.append(*make_sort_combo(page.list));
 
-    admin_services_title.set_halign(Gtk::Align::START);
-    admin_services_title.set_hexpand(true);
-    admin_services_box_title.append(admin_services_title);
+    page.title.set_halign(Gtk::Align::START);
+    page.title.set_hexpand(true);
+    page.box_title.append(page.title);
 
     auto add_service_btn = Gtk::make_managed<Gtk::Button>("Add Service >");
     add_service_btn->set_halign(Gtk::Align::END);
 
-    admin_services_box_title.append(*add_service_btn);
+    page.box_title.append(*add_service_btn);
 
-    admin_services_box.append(admin_services_box_title);
-    admin_services_box.append(admin_services_box_subtitle);
+    page.box.append(page.box_title);
+    page.box.append(page.box_subtitle);
     
     add_service_btn->get_style_context()->add_class("success");
     add_service_btn->signal_clicked().connect(sigc::mem_fun(*this, &MyWindow::on_add_service_clicked));
 
-    *services = get_services(db, 0);
-    for (auto &s : *services) {
-        if (s.status == filter_status->get_active_text() || filter_status->get_active_text() == "all")
-        {
-            auto w = Gtk::make_managed<ServiceRowWidget>(s,
-            [this](int id){ on_edit_service(id); },
-            [this](int id){ on_delete_service(id); });
-            admin_services_list_box.append(*w);
-        } 
-    }
+    page.list.model->set_query(ServiceQuery{});
+    page.list.load(&executor, 0);
     
-    admin_services_box.append(admin_services_list_box);
+    page.box.append(page.list);
     
-    admin_services_box.append(return_button);
+    page.box.append(return_button);
     
-    filter_entry->signal_changed().connect([this, filter_entry, services, filter_status]() {
-        clear_container(admin_services_list_box);
-                
-        for (auto &s : *services) {
-            std::regex pattern("(" + std::string(filter_entry->get_text()) + ")(.*)");
-            if (std::regex_match(s.client_name, pattern) && (filter_status->get_active_text() == s.status || filter_status->get_active_text() == "all")) {
-                auto w = Gtk::make_managed<ServiceRowWidget>(s,
-                [this](int id){ on_edit_service(id); },
-                [this](int id){ on_delete_service(id); });
-                admin_services_list_box.append(*w);
-
-                
-            }
-        }
+    filter_entry->signal_changed().connect([&page, filter_entry, filter_status]() {
+        page.list.set_filter_debounced(filter_entry->get_text(), filter_status->get_active_text());
     });
-    filter_status->signal_changed().connect([this, filter_entry, services, filter_status]() {
-        clear_container(admin_services_list_box);
-                
-        for (auto &s : *services) {
-            std::regex pattern("(" + std::string(filter_entry->get_text()) + ")(.*)");
-            if (std::regex_match(s.client_name, pattern) && (filter_status->get_active_text() == s.status || filter_status->get_active_text() == "all")) {
-                auto w = Gtk::make_managed<ServiceRowWidget>(s,
-                [this](int id){ on_edit_service(id); },
-                [this](int id){ on_delete_service(id); });
-                admin_services_list_box.append(*w);
-
-                
-            }
-        }
+    filter_status->signal_changed().connect([&page, filter_entry, filter_status]() {
+        page.list.set_filter(filter_entry->get_text(), filter_status->get_active_text());
     });
 
     navigate_to("admin_services_list");
 }
 
 void MyWindow::show_history_services() {
-    clear_container(admin_history_box);
-    clear_container(admin_history_box_title);
-    clear_container(admin_history_box_subtitle);
-    clear_container(admin_history_list_box);
-
+    ServiceListPage &page = history_page();
+    clear_container(page.box);
+    clear_container(page.box_title);
+    clear_container(page.box_subtitle);
 
-    auto services = std::make_shared<std::vector<ServiceRow>>();
-    
     auto filter_label = Gtk::make_managed<Gtk::Label>("Filter by: ");
     auto filter_entry = Gtk::make_managed<Gtk::Entry>();
-
-    admin_history_box_subtitle.append(*filter_label);
-    admin_history_box_subtitle.append(*filter_entry);
-
-    admin_history_title.set_halign(Gtk::Align::START);
-    admin_history_title.set_hexpand(true);
-    admin_history_box_title.append(admin_history_title);
-
-    admin_history_box.append(admin_history_box_title);
-    admin_history_box.append(admin_history_box_subtitle);
+    auto from_entry = Gtk::make_managed<Gtk::Entry>();
+    auto to_entry = Gtk::make_managed<Gtk::Entry>();
+    from_entry->set_placeholder_text("YYYY-MM-DD");
+    to_entry->set_placeholder_text("YYYY-MM-DD");
+    from_entry->set_max_length(10);
+    to_entry->set_max_length(10);
+
+    page.box_subtitle.append(*filter_label);
+    page.box_subtitle.append(*filter_entry);
+    page.box_subtitle.append(*Gtk::make_managed<Gtk::Label>("Created from: "));
+    page.box_subtitle.append(*from_entry);
+    page.box_subtitle.append(*Gtk::make_managed<Gtk::Label>("to: "));
+    page.box_subtitle.append(*to_entry);
+    page.box_subtitle.append(*Gtk::make_managed<Gtk::Label>("Sort by: "));
+    page.box_subtitle.append(*make_sort_combo(page.list));
+
+    page.title.set_halign(Gtk::Align::START);
+    page.title.set_hexpand(true);
+    page.box_title.append(page.title);
+
+    page.box.append(page.box_title);
+    page.box.append(page.box_subtitle);
     
-
-    *services = get_services(db, 0);
-    for (auto &s : *services) {
-        auto w = Gtk::make_managed<ServiceHistoryRowWidget>(s,
-        [this](int id){ on_edit_service(id); });
-        admin_history_list_box.append(*w);
-         
-    }
+    page.list.model->set_query(ServiceQuery{});
+    page.list.load(&executor, 0);
     
-    admin_history_box.append(admin_history_list_box);
+    page.box.append(page.list);
     
-    admin_history_box.append(return_button);
+    page.box.append(return_button);
     
-    filter_entry->signal_changed().connect([this, filter_entry, services]() {
-        clear_container(admin_history_list_box);
-                
-        for (auto &s : *services) {
-            std::regex pattern("(" + std::string(filter_entry->get_text()) + ")(.*)");
-            if (std::regex_match(s.client_name, pattern)) {
-                auto w = Gtk::make_managed<ServiceHistoryRowWidget>(s,
-                [this](int id){ on_edit_service(id); });
-                admin_history_list_box.append(*w);
-
-                
-            }
-        }
+    filter_entry->signal_changed().connect([&page, filter_entry]() {
+        page.list.set_filter_debounced(filter_entry->get_text(), "all");
     });
+    // a half-typed date changes nothing until it is complete
+    auto on_dates = [&page, from_entry, to_entry]() {
+        if (auto range = day_range(from_entry->get_text(), to_entry->get_text())) page.list.set_created_range(*range);
+    };
+    from_entry->signal_changed().connect(on_dates);
+    to_entry->signal_changed().connect(on_dates);
     update_return_button_visibility();
     navigate_to("admin_history_list");
   
@@ -807,14 +1091,21 @@ void MyWindow::on_add_service_clicked() {
     box->append(*btn_box);
 
     add_btn->signal_clicked().connect([this, e_client, e_phone, e_email, e_equip, e_problem, win]() {
-        if (add_service(e_client->get_text(), e_phone->get_text(), e_email->get_text(), e_equip->get_text(), e_problem->get_text(), logged_in_user_id, db)) {
-            show_admin_services();
-            win->hide();
-        } else {
-            Gtk::MessageDialog err(*this, "Failed to add service", false, Gtk::MessageType::ERROR);
-            err.set_modal(true);
-            err.show();
-        }
+        ServiceRow row;
+        row.client_name = e_client->get_text();
+        row.phone_number = e_phone->get_text();
+        row.email = e_email->get_text();
+        row.equipment = e_equip->get_text();
+        row.problem_report = e_problem->get_text();
+        service_repository.add(row, logged_in_user_id, [this, win](bool ok) {
+            if (ok) {
+                win->hide();
+            } else {
+                Gtk::MessageDialog err(*this, "Failed to add service", false, Gtk::MessageType::ERROR);
+                err.set_modal(true);
+                err.show();
+            }
+        });
     });
 
     cancel_btn->signal_clicked().connect([win]() { win->hide(); });
@@ -823,18 +1114,21 @@ void MyWindow::on_add_service_clicked() {
 }
 
 void MyWindow::on_edit_service(int service_id) {
-    auto services = get_services(db, 0);
-    ServiceRow srow;
-    bool found = false;
-    for (auto &s : services) {
-        if (s.service_id == service_id) { srow = s; found = true; break; }
-    }
-    if (!found) return;
+    service_repository.get(service_id, [this](std::optional<ServiceRow> srow) {
+        if (srow) open_edit_service_dialog(*srow);
+    });
+}
 
+void MyWindow::open_edit_service_dialog(const ServiceRow &srow) {
     auto win = Gtk::make_managed<Gtk::Window>();
     win->set_title("Edit Service");
     win->set_modal(true);
     win->set_transient_for(*this);
+    // closing destroys the window, and with it the timeline's feed subscription
+    win->set_hide_on_close(false);
+    // an update finishing after Cancel must not touch the destroyed window
+    auto alive = std::make_shared<bool>(true);
+    win->signal_destroy().connect([alive]() { *alive = false; });
 
     auto box = Gtk::make_managed<Gtk::Box>(Gtk::Orientation::VERTICAL, 6);
     box->set_margin(20);
@@ -853,19 +1147,18 @@ void MyWindow::on_edit_service(int service_id) {
     e_email->set_text(srow.email);
     e_equipment->set_text(srow.equipment);
     e_problem->set_text(srow.problem_report);
-    e_status->append("open");
-    e_status->append("diagnosing");
-    e_status->append("repair");
-    e_status->append("done");
-    e_status->append("delivered");
-    e_status->append("canceled");
-    e_status->set_active_text(srow.status);
+    // only the moves the lifecycle allows, so an edit cannot be refused
+    for (size_t i = 0; i < SERVICE_STATUS_COUNT; i++) {
+        if (can_transition(srow.status, ServiceStatus(i))) e_status->append(SERVICE_STATUS_NAMES[i]);
+    }
+    e_status->set_active_text(status_name(srow.status));
     box->append(*e_client);
     box->append(*e_phone);
     box->append(*e_email);
     box->append(*e_equipment);
     box->append(*e_problem);
     box->append(*e_status);
+    box->append(*Gtk::make_managed<TimelineView>(executor, change_feed, srow.service_id, logged_in_user_id));
 
     auto btn_box = Gtk::make_managed<Gtk::Box>(Gtk::Orientation::HORIZONTAL, 6);
     btn_box->set_halign(Gtk::Align::END);
@@ -879,29 +1172,30 @@ void MyWindow::on_edit_service(int service_id) {
     btn_box->append(*cancel_btn);
     btn_box->append(*save_btn);
     box->append(*btn_box);
-    int id = srow.service_id;
     
-    save_btn->signal_clicked().connect([this, id, srow, e_client, e_phone, e_email, e_equipment, e_problem, e_status, win]() {
-        std::string client = e_client->get_text();
-        std::string phone = e_phone->get_text();
-        std::string email = e_email->get_text();
-        std::string equipment = e_equipment->get_text();
-        std::string problem = e_problem->get_text();
-        std::string status = e_status->get_active_text();
-        
-        if (edit_service(id, client, phone, email, equipment, problem, srow.created_by_id, status, db)) {
-            std::cout << "edited service\n";
-            show_admin_services();
-            win->hide();
-        } else {
-            std::cout << "failed to edit service\n";
-            Gtk::MessageDialog err(*this, "Failed to edit service", false, Gtk::MessageType::ERROR);
-            err.set_modal(true);
-            err.show();
-        }
+    save_btn->signal_clicked().connect([this, srow, e_client, e_phone, e_email, e_equipment, e_problem, e_status, win, alive]() {
+        ServiceRow edited = srow;
+        edited.client_name = e_client->get_text();
+        edited.phone_number = e_phone->get_text();
+        edited.email = e_email->get_text();
+        edited.equipment = e_equipment->get_text();
+        edited.problem_report = e_problem->get_text();
+        edited.status = status_code(e_status->get_active_text().raw());
+
+        service_repository.update(edited, logged_in_user_id, [this, win, alive](bool ok) {
+            if (ok) {
+                std::cout << "edited service\n";
+                if (*alive) win->close();
+            } else {
+                std::cout << "failed to edit service\n";
+                Gtk::MessageDialog err(*this, "Failed to edit service", false, Gtk::MessageType::ERROR);
+                err.set_modal(true);
+                err.show();
+            }
+        });
     });
     
-    cancel_btn->signal_clicked().connect([win]() { win->hide(); });
+    cancel_btn->signal_clicked().connect([win]() { win->close(); });
 
     win->show();
 }
@@ -920,20 +1214,20 @@ void MyWindow::on_delete_service(int service_id) {
     dialog->signal_response().connect(
         [this, service_id, dialog](int response_id) {
             if (response_id == Gtk::ResponseType::OK) {
-                if (!delete_service(service_id, db)) {
-                    auto err = std::make_shared<Gtk::MessageDialog>(
-                        *this,
-                        "Failed to delete service",
-                        false,
-                        Gtk::MessageType::ERROR,
-                        Gtk::ButtonsType::OK
-                    );
-                    err->set_modal(true);
-                    err->signal_response().connect([err](int) {});
-                    err->show();
-                } else {
-                    show_admin_services();
-                }
+                service_repository.remove(service_id, [this](bool ok) {
+                    if (!ok) {
+                        auto err = std::make_shared<Gtk::MessageDialog>(
+                            *this,
+                            "Failed to delete service",
+                            false,
+                            Gtk::MessageType::ERROR,
+                            Gtk::ButtonsType::OK
+                        );
+                        err->set_modal(true);
+                        err->signal_response().connect([err](int) {});
+                        err->show();
+                    }
+                });
             }
         }
     );
@@ -941,13 +1235,109 @@ void MyWindow::on_delete_service(int service_id) {
     dialog->show();
 }
 
+void MyWindow::on_assign_technician_clicked(int service_id) {
+    executor.run_read([](sqlite3 *db) { return get_users(db); },
+                 [this, service_id](std::vector<UserRow> uv) {
+        auto win = Gtk::make_managed<Gtk::Window>();
+        win->set_title("Assign Technician");
+        win->set_modal(true);
+        auto box = Gtk::make_managed<Gtk::Box>();
+        auto technicians_box = Gtk::make_managed<Gtk::ComboBoxText>();
+        for (auto &u: uv) {
+            if (u.role_id == 3) {
+                technicians_box->append(std::to_string(u.user_id), u.full_name);
+            }
+        }
+        auto confirm_assign_btn = Gtk::make_managed<Gtk::Button>("Confirm");
+
+        box->append(*technicians_box);
+        box->append(*confirm_assign_btn);
+
+        win->set_child(*box);
+
+        confirm_assign_btn->signal_clicked().connect([this, technicians_box, service_id, win](){
+            std::string tech_id = technicians_box->get_active_id();
+            if (tech_id.empty()) return;
+            service_repository.assign(service_id, std::stoi(tech_id), [win](bool ok) {
+                if (ok) std::cout << "assigned.\n";
+                win->close();
+            });
+        });
+
+        win->show();        
+    });
+}
+
+// Where dump_trace() writes, SGOS_TRACE_FILE or next to the database.
+static std::string trace_path()
+{
+    const char *path = g_getenv("SGOS_TRACE_FILE");
+    return path ? path : "../sgos_trace.json";
+}
+
+using Clock = std::chrono::steady_clock;
+
+// As close to process start as static initialisation gets, for --startup-bench.
+static const Clock::time_point process_start = Clock::now();
+
+static double ms_since_start()
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - process_start).count();
+}
+
+// main --startup-bench
+// Starts as usual, prints when each start-up phase finished as JSON once the
+// login screen's first frame is painted, and quits.
+static void report_first_frame(Gtk::Window *window, double db_ms)
+{
+    double window_ms = ms_since_start();
+    window->signal_realize().connect([window, db_ms, window_ms] {
+        auto painted = std::make_shared<sigc::connection>();
+        *painted = window->get_frame_clock()->signal_after_paint().connect([window, db_ms, window_ms, painted] {
+            painted->disconnect();
+            printf("{\"database_ms\": %.2f, \"window_ms\": %.2f, \"first_frame_ms\": %.2f}\n",
+                   db_ms, window_ms, ms_since_start());
+            Glib::signal_idle().connect_once([window] { window->close(); });
+        });
+    });
+}
+
+// main --import services|users FILE [REJECTS]
+// Bulk loads a CSV or JSONL export into the database without starting the UI.
+static int run_import(int argc, char* argv[])
+{
+    std::string what = argc > 2 ? argv[2] : "";
+    if (argc < 4 || (what != "services" && what != "users")) {
+        std::cerr << "usage: " << argv[0] << " --import services|users FILE [REJECTS]\n";
+        return 2;
+    }
+    if (!connect("test", db)) return 1;
+    initDatabase(db);
+
+    ImportOptions options;
+    if (argc > 4) options.reject_path = argv[4];
+    options.on_progress = [](const ImportProgress &p) {
+        std::cerr << "\rimported " << p.imported << ", rejected " << p.rejected << std::flush;
+    };
+    ImportKind kind = what == "services" ? ImportKind::Services : ImportKind::Users;
+    ImportProgress result = import_file(kind, argv[3], options, db);
+    std::cerr << "\n" << result.read << " records read, " << result.imported << " imported, "
+              << result.rejected << " rejected\n";
+    if (!result.error.empty()) std::cerr << "import failed: " << result.error << "\n";
+    disconnect(db);
+    return result.rejected == 0 && result.error.empty() ? 0 : 1;
+}
+
 int main(int argc, char* argv[])
 {
+    if (argc > 1 && std::string(argv[1]) == "--import") return run_import(argc, argv);
+    bool startup_bench = argc > 1 && std::string(argv[1]) == "--startup-bench";
+
     g_setenv("GTK_CSD", "0", TRUE);
     auto app = Gtk::Application::create("org.gtkmm.login");
     
     auto provider = Gtk::CssProvider::create();
-    provider->load_from_path("../style/main.css");
+    provider->load_from_resource("/org/gtkmm/login/style/main.css");
     Gtk::StyleContext::add_provider_for_display(
         Gdk::Display::get_default(),
         provider,
@@ -956,6 +1346,21 @@ int main(int argc, char* argv[])
     int err = connect("test", db);
 
     initDatabase(db);
-    add_user("admin", "admin", "admin", "1111", 1, db);
-    return app->make_window_and_run<MyWindow>(argc, argv, db);
+
+    // kill -USR1 writes the latencies so far; they are written again on exit
+    g_unix_signal_add(SIGUSR1, [](gpointer) -> gboolean {
+        dump_trace(trace_path());
+        return G_SOURCE_CONTINUE;
+    }, nullptr);
+    if (startup_bench) {
+        double db_ms = ms_since_start();
+        app->signal_window_added().connect([db_ms](Gtk::Window *window) {
+            report_first_frame(window, db_ms);
+        });
+    }
+    // GApplication would reject --startup-bench as an unknown option
+    int status = app->make_window_and_run<MyWindow>(startup_bench ? 1 : argc, argv, db);
+    dump_trace(trace_path());
+    disconnect(db);
+    return status;
 }
\ No newline at end of file
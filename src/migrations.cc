@@ -0,0 +1,473 @@
+#include "../include/db.h"
+#include "../include/query_trace.h"
+#include "../include/stmt_cache.h"
+#include <iterator>
+#include <string>
+
+namespace {
+
+// One step of the schema. Steps run in order of version, each exactly once,
+// in a transaction that also sets PRAGMA user_version to the step's version.
+// A step is either a script or, when it needs code, a function.
+struct Migration {
+    int version;
+    const char *description;
+    const char *sql;
+    bool (*apply)(sqlite3 *db);
+    // The step drops and recreates tables that others reference, which
+    // foreign key enforcement would turn into cascading deletes; it is
+    // switched off around the step's transaction.
+    bool rebuilds_tables = false;
+};
+
+// The schema as it stood before versioning. Every statement is IF NOT
+// EXISTS or OR IGNORE, so databases created by the old start-up script are
+// adopted as they are.
+const char *const BASE_SCHEMA = R"(
+
+-- ======================
+-- ROLES
+-- ======================
+CREATE TABLE IF NOT EXISTS roles (
+    role_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    name TEXT NOT NULL UNIQUE
+);
+
+INSERT OR IGNORE INTO roles (name) VALUES
+('admin'),
+('commercial'),
+('technician');
+
+
+-- ======================
+-- USERS
+-- ======================
+CREATE TABLE IF NOT EXISTS users (
+    user_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    full_name TEXT NOT NULL,
+    email TEXT UNIQUE,
+    username TEXT UNIQUE NOT NULL,
+    access_code_hash TEXT NOT NULL,   -- hashed pass
+    role_id INTEGER NOT NULL,
+    created_at DEFAULT CURRENT_TIMESTAMP,
+    FOREIGN KEY (role_id) REFERENCES roles(role_id)
+);
+
+
+-- ======================
+-- SERVICE REQUESTS
+-- ======================
+CREATE TABLE IF NOT EXISTS services (
+    service_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    client_name TEXT NOT NULL,
+    client_phone TEXT,
+    client_email TEXT,
+    equipment_desc TEXT,              
+    problem_report TEXT,
+    created_by_id INTEGER NOT NULL,
+    status TEXT NOT NULL DEFAULT 'open'
+        CHECK(status IN ('open','diagnosing','repair','done','delivered','canceled')),
+    created_at DEFAULT CURRENT_TIMESTAMP,
+    closed_at,
+    FOREIGN KEY (created_by_id) REFERENCES users(user_id)
+);
+
+
+-- ======================
+-- SERVICE HISTORY (log of service stage changes or text notes)
+-- ======================
+CREATE TABLE IF NOT EXISTS service_history (
+    history_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    service_id INTEGER NOT NULL,
+    user_id INTEGER,
+    note TEXT,
+    status TEXT CHECK(status IN ('open','diagnosing','repair','done','delivered','canceled')),
+    created_at DEFAULT CURRENT_TIMESTAMP,
+    FOREIGN KEY(service_id) REFERENCES services(service_id),
+    FOREIGN KEY(user_id) REFERENCES users(user_id)
+);
+
+
+-- ======================
+-- ACTION LOGS (who did what)
+-- ======================
+CREATE TABLE IF NOT EXISTS action_logs (
+    log_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    user_id INTEGER,
+    action TEXT NOT NULL,
+    details TEXT,
+    created_at DEFAULT CURRENT_TIMESTAMP,
+    FOREIGN KEY (user_id) REFERENCES users(user_id)
+);
+
+
+-- ======================
+-- CHANGE LOGS
+-- Stores old → new value per field
+-- ======================
+CREATE TABLE IF NOT EXISTS change_logs (
+    change_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    change_type TEXT,
+    service_id INTEGER,
+    user_id INTEGER,
+    field TEXT NOT NULL,
+    old_value TEXT,
+    new_value TEXT,
+    created_at DEFAULT CURRENT_TIMESTAMP,
+    FOREIGN KEY(service_id) REFERENCES services(service_id),
+    FOREIGN KEY(user_id) REFERENCES users(user_id)
+);
+
+CREATE TABLE IF NOT EXISTS service_technicians (
+    service_id INTEGER NOT NULL,
+    technician_id INTEGER NOT NULL,
+    assigned_at DEFAULT CURRENT_TIMESTAMP,
+    PRIMARY KEY (service_id, technician_id),
+    FOREIGN KEY (service_id) REFERENCES services(service_id) ON DELETE CASCADE,
+    FOREIGN KEY (technician_id) REFERENCES users(user_id) ON DELETE CASCADE
+);
+
+-- keyset pagination of the services list
+CREATE INDEX IF NOT EXISTS idx_services_created ON services(created_at, service_id);
+
+-- technician view: services assigned to one technician
+CREATE INDEX IF NOT EXISTS idx_service_technicians_technician ON service_technicians(technician_id, service_id);
+
+-- a service's timeline, newest first; also serves the foreign key to services
+-- (replaces idx_service_history_service of databases made before versioning)
+DROP INDEX IF EXISTS idx_service_history_service;
+CREATE INDEX IF NOT EXISTS idx_service_history_timeline ON service_history(service_id, created_at);
+
+-- get_user_by_name; try_login is served by the UNIQUE index on username
+CREATE INDEX IF NOT EXISTS idx_users_full_name ON users(full_name);
+
+-- foreign key children, so deleting a service or user does not scan them
+CREATE INDEX IF NOT EXISTS idx_services_created_by ON services(created_by_id);
+CREATE INDEX IF NOT EXISTS idx_service_history_user ON service_history(user_id);
+CREATE INDEX IF NOT EXISTS idx_change_logs_service ON change_logs(service_id);
+CREATE INDEX IF NOT EXISTS idx_change_logs_user ON change_logs(user_id);
+CREATE INDEX IF NOT EXISTS idx_action_logs_user ON action_logs(user_id);
+
+-- the first login; change its access code after setting up real users
+INSERT OR IGNORE INTO users (full_name, email, username, access_code_hash, role_id)
+VALUES ('admin', 'admin', 'admin', '1111', 1);
+)";
+
+// services.status and service_history.status become ServiceStatus codes.
+// SQLite cannot change a column's type, so both tables are copied into new
+// ones, keeping every id and each table's AUTOINCREMENT counter. Dropping
+// services also drops the search triggers; initDatabase() recreates them.
+const char *const INTEGER_STATUS = R"(
+CREATE TABLE services_new (
+    service_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    client_name TEXT NOT NULL,
+    client_phone TEXT,
+    client_email TEXT,
+    equipment_desc TEXT,
+    problem_report TEXT,
+    created_by_id INTEGER NOT NULL,
+    status INTEGER NOT NULL DEFAULT 0 CHECK(status BETWEEN 0 AND 5),   -- ServiceStatus
+    created_at DEFAULT CURRENT_TIMESTAMP,
+    closed_at,
+    FOREIGN KEY (created_by_id) REFERENCES users(user_id)
+);
+INSERT INTO services_new (service_id, client_name, client_phone, client_email, equipment_desc,
+                          problem_report, created_by_id, status, created_at, closed_at)
+SELECT service_id, client_name, client_phone, client_email, equipment_desc,
+       problem_report, created_by_id,
+       CASE status WHEN 'open' THEN 0 WHEN 'diagnosing' THEN 1 WHEN 'repair' THEN 2
+                   WHEN 'done' THEN 3 WHEN 'delivered' THEN 4 WHEN 'canceled' THEN 5 END,
+       created_at, closed_at
+FROM services;
+DELETE FROM sqlite_sequence WHERE name = 'services_new';
+INSERT INTO sqlite_sequence (name, seq) SELECT 'services_new', seq FROM sqlite_sequence WHERE name = 'services';
+DROP TABLE services;
+ALTER TABLE services_new RENAME TO services;
+
+CREATE INDEX idx_services_created ON services(created_at, service_id);
+CREATE INDEX idx_services_created_by ON services(created_by_id);
+-- counts by status, and the services in one status newest first
+CREATE INDEX idx_services_status ON services(status, created_at);
+
+CREATE TABLE service_history_new (
+    history_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    service_id INTEGER NOT NULL,
+    user_id INTEGER,
+    note TEXT,
+    status INTEGER CHECK(status BETWEEN 0 AND 5),   -- ServiceStatus, NULL if unchanged
+    created_at DEFAULT CURRENT_TIMESTAMP,
+    FOREIGN KEY(service_id) REFERENCES services(service_id),
+    FOREIGN KEY(user_id) REFERENCES users(user_id)
+);
+INSERT INTO service_history_new (history_id, service_id, user_id, note, status, created_at)
+SELECT history_id, service_id, user_id, note,
+       CASE status WHEN 'open' THEN 0 WHEN 'diagnosing' THEN 1 WHEN 'repair' THEN 2
+                   WHEN 'done' THEN 3 WHEN 'delivered' THEN 4 WHEN 'canceled' THEN 5 END,
+       created_at
+FROM service_history;
+DELETE FROM sqlite_sequence WHERE name = 'service_history_new';
+INSERT INTO sqlite_sequence (name, seq)
+SELECT 'service_history_new', seq FROM sqlite_sequence WHERE name = 'service_history';
+DROP TABLE service_history;
+ALTER TABLE service_history_new RENAME TO service_history;
+
+CREATE INDEX idx_service_history_timeline ON service_history(service_id, created_at);
+CREATE INDEX idx_service_history_user ON service_history(user_id);
+)";
+
+// services.created_at and closed_at become unix times. They held the text
+// CURRENT_TIMESTAMP writes, in UTC; a value that is already a number is
+// kept. Only imports ever set closed_at, so other closed services take the
+// time of their last move to a closed status from the timeline, where it
+// has one.
+const char *const EPOCH_TIMES = R"(
+CREATE TABLE services_new (
+    service_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    client_name TEXT NOT NULL,
+    client_phone TEXT,
+    client_email TEXT,
+    equipment_desc TEXT,
+    problem_report TEXT,
+    created_by_id INTEGER NOT NULL,
+    status INTEGER NOT NULL DEFAULT 0 CHECK(status BETWEEN 0 AND 5),   -- ServiceStatus
+    created_at INTEGER NOT NULL DEFAULT (CAST(strftime('%s', 'now') AS INTEGER)),   -- unix time
+    closed_at INTEGER,                                                               -- unix time
+    FOREIGN KEY (created_by_id) REFERENCES users(user_id)
+);
+INSERT INTO services_new (service_id, client_name, client_phone, client_email, equipment_desc,
+                          problem_report, created_by_id, status, created_at, closed_at)
+SELECT s.service_id, s.client_name, s.client_phone, s.client_email, s.equipment_desc,
+       s.problem_report, s.created_by_id, s.status,
+       coalesce(CASE WHEN typeof(s.created_at) IN ('integer', 'real') THEN CAST(s.created_at AS INTEGER)
+                     ELSE CAST(strftime('%s', s.created_at) AS INTEGER) END, 0),
+       CASE WHEN s.status NOT IN (3, 4, 5) THEN NULL
+            WHEN typeof(s.closed_at) IN ('integer', 'real') THEN CAST(s.closed_at AS INTEGER)
+            ELSE coalesce(CAST(strftime('%s', s.closed_at) AS INTEGER),
+                          (SELECT CAST(strftime('%s', max(h.created_at)) AS INTEGER) FROM service_history h
+                           WHERE h.service_id = s.service_id AND h.status IN (3, 4, 5))) END
+FROM services s;
+DELETE FROM sqlite_sequence WHERE name = 'services_new';
+INSERT INTO sqlite_sequence (name, seq) SELECT 'services_new', seq FROM sqlite_sequence WHERE name = 'services';
+DROP TABLE services;
+ALTER TABLE services_new RENAME TO services;
+
+CREATE INDEX idx_services_created ON services(created_at, service_id);
+CREATE INDEX idx_services_created_by ON services(created_by_id);
+CREATE INDEX idx_services_status ON services(status, created_at);
+)";
+
+// Counts of services kept current by triggers, so the dashboard reads a few
+// rows however many services there are. Each row counts the services in one
+// status within a scope:
+//   scope 0, key 0               every service
+//   scope 1, key technician_id   the services assigned to that technician;
+//                                key 0 holds those with no technician
+//   scope 2, key created_at / 86400
+//                                the services created on that UTC day
+// A service with several technicians counts once for each of them in scope
+// 1. The service delete trigger runs BEFORE, while its assignments are
+// still there; the cascade that removes them afterwards finds no service
+// and leaves the counts alone.
+const char *const SERVICE_COUNTS = R"(
+CREATE TABLE service_counts (
+    scope INTEGER NOT NULL,
+    key INTEGER NOT NULL,
+    status INTEGER NOT NULL,   -- ServiceStatus
+    count INTEGER NOT NULL,
+    PRIMARY KEY (scope, key, status)
+) WITHOUT ROWID;
+
+INSERT INTO service_counts (scope, key, status, count)
+SELECT 0, 0, status, count(*) FROM services GROUP BY status;
+INSERT INTO service_counts (scope, key, status, count)
+SELECT 1, coalesce(t.technician_id, 0), s.status, count(*)
+FROM services s LEFT JOIN service_technicians t ON t.service_id = s.service_id
+GROUP BY 2, 3;
+INSERT INTO service_counts (scope, key, status, count)
+SELECT 2, created_at / 86400, status, count(*) FROM services GROUP BY 2, 3;
+
+CREATE TRIGGER service_counts_insert AFTER INSERT ON services BEGIN
+    INSERT INTO service_counts (scope, key, status, count)
+    VALUES (0, 0, new.status, 1), (1, 0, new.status, 1), (2, new.created_at / 86400, new.status, 1)
+    ON CONFLICT DO UPDATE SET count = count + 1;
+END;
+
+CREATE TRIGGER service_counts_update AFTER UPDATE OF status, created_at ON services
+WHEN old.status <> new.status OR old.created_at <> new.created_at BEGIN
+    UPDATE service_counts SET count = count - 1
+    WHERE scope = 0 AND key = 0 AND status = old.status;
+    UPDATE service_counts SET count = count - 1
+    WHERE scope = 1 AND status = old.status
+      AND key IN (SELECT technician_id FROM service_technicians WHERE service_id = old.service_id
+                  UNION ALL
+                  SELECT 0 WHERE NOT EXISTS (SELECT 1 FROM service_technicians
+                                             WHERE service_id = old.service_id));
+    UPDATE service_counts SET count = count - 1
+    WHERE scope = 2 AND key = old.created_at / 86400 AND status = old.status;
+    INSERT INTO service_counts (scope, key, status, count)
+    SELECT 0, 0, new.status, 1
+    UNION ALL
+    SELECT 1, technician_id, new.status, 1 FROM service_technicians WHERE service_id = new.service_id
+    UNION ALL
+    SELECT 1, 0, new.status, 1 WHERE NOT EXISTS (SELECT 1 FROM service_technicians
+                                                 WHERE service_id = new.service_id)
+    UNION ALL
+    SELECT 2, new.created_at / 86400, new.status, 1 WHERE true
+    ON CONFLICT DO UPDATE SET count = count + 1;
+END;
+
+CREATE TRIGGER service_counts_delete BEFORE DELETE ON services BEGIN
+    UPDATE service_counts SET count = count - 1
+    WHERE scope = 0 AND key = 0 AND status = old.status;
+    UPDATE service_counts SET count = count - 1
+    WHERE scope = 1 AND status = old.status
+      AND key IN (SELECT technician_id FROM service_technicians WHERE service_id = old.service_id
+                  UNION ALL
+                  SELECT 0 WHERE NOT EXISTS (SELECT 1 FROM service_technicians
+                                             WHERE service_id = old.service_id));
+    UPDATE service_counts SET count = count - 1
+    WHERE scope = 2 AND key = old.created_at / 86400 AND status = old.status;
+END;
+
+-- the first technician takes the service out of the unassigned count
+CREATE TRIGGER service_counts_assign AFTER INSERT ON service_technicians
+WHEN EXISTS (SELECT 1 FROM services WHERE service_id = new.service_id) BEGIN
+    UPDATE service_counts SET count = count - 1
+    WHERE scope = 1 AND key = 0
+      AND status = (SELECT status FROM services WHERE service_id = new.service_id)
+      AND NOT EXISTS (SELECT 1 FROM service_technicians
+                      WHERE service_id = new.service_id AND technician_id <> new.technician_id);
+    INSERT INTO service_counts (scope, key, status, count)
+    SELECT 1, new.technician_id, status, 1 FROM services WHERE service_id = new.service_id
+    ON CONFLICT DO UPDATE SET count = count + 1;
+END;
+
+-- and removing the last one puts it back
+CREATE TRIGGER service_counts_unassign AFTER DELETE ON service_technicians
+WHEN EXISTS (SELECT 1 FROM services WHERE service_id = old.service_id) BEGIN
+    UPDATE service_counts SET count = count - 1
+    WHERE scope = 1 AND key = old.technician_id
+      AND status = (SELECT status FROM services WHERE service_id = old.service_id);
+    INSERT INTO service_counts (scope, key, status, count)
+    SELECT 1, 0, status, 1 FROM services
+    WHERE service_id = old.service_id
+      AND NOT EXISTS (SELECT 1 FROM service_technicians WHERE service_id = old.service_id)
+    ON CONFLICT DO UPDATE SET count = count + 1;
+END;
+)";
+
+bool create_search_index(sqlite3 *db) {
+    // without FTS5 this logs and leaves search off; it is not an error
+    init_search_index(db);
+    return true;
+}
+
+// Append new steps at the end with the next version; never edit or reorder
+// a step that has shipped.
+const Migration MIGRATIONS[] = {
+    {1, "base schema", BASE_SCHEMA, nullptr},
+    {2, "full-text search index", nullptr, create_search_index},
+    {3, "integer service status", INTEGER_STATUS, nullptr, true},
+    {4, "unix times for services", EPOCH_TIMES, nullptr, true},
+    {5, "service counts", SERVICE_COUNTS, nullptr},
+};
+
+bool exec_sql(sqlite3 *db, const std::string &sql) {
+    char *err_msg = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "migrate: " << err_msg << std::endl;
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+bool foreign_keys_enabled(sqlite3 *db) {
+    CachedStmt stmt(db, "PRAGMA foreign_keys;");
+    return stmt && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) != 0;
+}
+
+// PRAGMA user_version as stored, flags included; -1 if it cannot be read.
+int user_version(sqlite3 *db) {
+    CachedStmt stmt(db, "PRAGMA user_version;");
+    if (!stmt || sqlite3_step(stmt) != SQLITE_ROW) {
+        std::cerr << "schema_version: " << sqlite3_errmsg(db) << "\n";
+        return -1;
+    }
+    return sqlite3_column_int(stmt, 0);
+}
+
+bool run_migration(const Migration &m, sqlite3 *db) {
+    if (!exec_sql(db, "BEGIN IMMEDIATE;")) return false;
+    // another process may have applied it while this one waited for the lock
+    if (schema_version(db) >= m.version) return exec_sql(db, "COMMIT;");
+
+    bool ok = m.sql ? exec_sql(db, m.sql) : m.apply(db);
+    // read after the step, which may have cleared a flag itself
+    int stored = ok ? user_version(db) : -1;
+    ok = stored >= 0 &&
+         exec_sql(db, "PRAGMA user_version = " + std::to_string(m.version | (stored & SCHEMA_FLAGS)) + ";");
+    ok = ok && exec_sql(db, "COMMIT;");
+    if (!ok) {
+        std::cerr << "migration " << m.version << " (" << m.description << ") failed\n";
+        if (!sqlite3_get_autocommit(db)) execute_query("ROLLBACK;", db);
+    }
+    return ok;
+}
+
+bool apply_migration(const Migration &m, sqlite3 *db) {
+    // the pragma is a no-op inside a transaction, so it goes around it; the
+    // copied rows keep their ids, so every reference still holds afterwards
+    bool restore_keys = m.rebuilds_tables && foreign_keys_enabled(db);
+    if (restore_keys && !exec_sql(db, "PRAGMA foreign_keys = OFF;")) return false;
+    bool ok = run_migration(m, db);
+    if (restore_keys) exec_sql(db, "PRAGMA foreign_keys = ON;");
+    return ok;
+}
+
+}
+
+int schema_version(sqlite3 *db) {
+    int version = user_version(db);
+    return version < 0 ? version : version & ~SCHEMA_FLAGS;
+}
+
+bool set_schema_flag(sqlite3 *db, int flag, bool on) {
+    int version = user_version(db);
+    if (version < 0) return false;
+    int next = on ? version | flag : version & ~flag;
+    return next == version || exec_sql(db, "PRAGMA user_version = " + std::to_string(next) + ";");
+}
+
+int latest_schema_version() {
+    return std::end(MIGRATIONS)[-1].version;
+}
+
+bool migrate(sqlite3 *db) {
+    TraceScope trace("migrate");
+    // one read on a current database; a flag set makes it differ
+    int stored = user_version(db);
+    if (stored == latest_schema_version()) return true;
+    if (stored < 0) return false;
+    int version = stored & ~SCHEMA_FLAGS;
+    if (version > latest_schema_version()) {
+        std::cerr << "migrate: database schema " << version << " is newer than this build ("
+                  << latest_schema_version() << ")\n";
+        return false;
+    }
+    for (const Migration &m : MIGRATIONS) {
+        if (m.version <= version) continue;
+        if (!apply_migration(m, db)) return false;
+    }
+    // a bulk load died before restoring what it suspended
+    if (stored & SEARCH_INDEX_SUSPENDED) init_search_index(db);
+    if (stored & SERVICE_COUNTS_SUSPENDED) return init_service_counts(db);
+    return true;
+}
+
+bool replay_migration(sqlite3 *db, int version) {
+    for (const Migration &m : MIGRATIONS) {
+        if (m.version == version) return m.sql ? exec_sql(db, m.sql) : m.apply(db);
+    }
+    return false;
+}
@@ -0,0 +1,246 @@
+#include "../include/parallel_query.h"
+#include <algorithm>
+#include <cstdint>
+
+WorkerPool::WorkerPool(size_t count) {
+    for (size_t i = 0; i < count; i++) threads.emplace_back(&WorkerPool::worker_loop, this);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (auto &t : threads) t.join();
+}
+
+bool WorkerPool::claim(size_t &task) {
+    if (!job || next_task == total) return false;
+    task = next_task++;
+    return true;
+}
+
+void WorkerPool::run(size_t tasks, const std::function<void(size_t)> &fn) {
+    if (tasks == 0) return;
+    std::unique_lock<std::mutex> lock(mutex);
+    job = &fn;
+    next_task = 0;
+    total = tasks;
+    finished = 0;
+    work_cv.notify_all();
+
+    size_t task;
+    while (claim(task)) {
+        lock.unlock();
+        fn(task);
+        lock.lock();
+        finished++;
+    }
+    done_cv.wait(lock, [this] { return finished == total; });
+    job = nullptr;
+}
+
+void WorkerPool::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        work_cv.wait(lock, [this] { return stopping || (job && next_task < total); });
+        if (stopping) return;
+        size_t task;
+        while (claim(task)) {
+            const auto &fn = *job;
+            lock.unlock();
+            fn(task);
+            lock.lock();
+            if (++finished == total) done_cv.notify_one();
+        }
+    }
+}
+
+WorkerPool &query_pool() {
+    static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+namespace {
+
+// Below this many rows a partition costs more to hand out than to scan.
+constexpr size_t PARTITION_ROWS = 32 * 1024;
+
+size_t partitions_for(size_t n, const WorkerPool &pool) {
+    size_t parts = (n + PARTITION_ROWS - 1) / PARTITION_ROWS;
+    return std::clamp<size_t>(parts, 1, pool.size() * 2);
+}
+
+// [begin, end) of partition part out of parts over n items.
+std::pair<size_t, size_t> partition(size_t n, size_t parts, size_t part) {
+    return {n * part / parts, n * (part + 1) / parts};
+}
+
+void for_partitions(size_t parts, WorkerPool &pool, const std::function<void(size_t)> &fn) {
+    if (parts == 1) fn(0);
+    else pool.run(parts, fn);
+}
+
+template<class T>
+std::vector<T> concat(std::vector<std::vector<T>> &parts) {
+    if (parts.size() == 1) return std::move(parts[0]);
+    size_t n = 0;
+    for (const auto &p : parts) n += p.size();
+    std::vector<T> out;
+    out.reserve(n);
+    for (const auto &p : parts) out.insert(out.end(), p.begin(), p.end());
+    return out;
+}
+
+// A row's primary sort key, inverted for descending orders so every order
+// sorts keys ascending. Comparing keys decides most pairs without touching
+// the columns again; Client only goes back to the names when the first
+// eight bytes tie.
+struct Keyed {
+    uint64_t key;
+    uint32_t index;
+};
+
+uint64_t column_key(const ServiceSnapshot &rows, SortKey key, uint32_t index) {
+    switch (key) {
+        case SortKey::ListOrder:
+            return index;
+        case SortKey::Client: {
+            std::string_view name = rows.name_key(index);
+            uint64_t k = 0;
+            for (size_t i = 0; i < 8; i++) {
+                k = (k << 8) | (i < name.size() ? uint8_t(name[i]) : 0);
+            }
+            return k;
+        }
+        case SortKey::Status:
+            return uint64_t(rows.status(index));
+        case SortKey::Created:
+            return uint64_t(rows.created(index));
+        case SortKey::Technician: {
+            int id = rows.technician(index);
+            return id == 0 ? UINT64_MAX : uint64_t(id);
+        }
+    }
+    return index;
+}
+
+bool inverted(const SortOrder &order) {
+    return order.descending && order.key != SortKey::ListOrder;
+}
+
+Keyed keyed(const ServiceSnapshot &rows, const SortOrder &order, uint32_t index) {
+    uint64_t k = column_key(rows, order.key, index);
+    return Keyed{inverted(order) ? ~k : k, index};
+}
+
+struct KeyedBefore {
+    const ServiceSnapshot &rows;
+    bool by_name;
+    bool descending;
+
+    KeyedBefore(const ServiceSnapshot &rows, const SortOrder &order)
+    : rows(rows), by_name(order.key == SortKey::Client), descending(inverted(order)) {}
+
+    bool operator()(const Keyed &a, const Keyed &b) const {
+        if (a.key != b.key) return a.key < b.key;
+        if (by_name) {
+            int c = rows.name_key(a.index).compare(rows.name_key(b.index));
+            if (c != 0) return descending ? c > 0 : c < 0;
+        }
+        return a.index < b.index;
+    }
+};
+
+// Merges sorted runs pairwise, each round's merges in parallel.
+std::vector<Keyed> merge_runs(std::vector<std::vector<Keyed>> runs, const KeyedBefore &before,
+                              WorkerPool &pool) {
+    while (runs.size() > 1) {
+        size_t pairs = runs.size() / 2;
+        std::vector<std::vector<Keyed>> merged(pairs + runs.size() % 2);
+        for_partitions(pairs, pool, [&](size_t p) {
+            auto &a = runs[2 * p], &b = runs[2 * p + 1];
+            merged[p].resize(a.size() + b.size());
+            std::merge(a.begin(), a.end(), b.begin(), b.end(), merged[p].begin(), before);
+            std::vector<Keyed>().swap(a);
+            std::vector<Keyed>().swap(b);
+        });
+        if (runs.size() % 2) merged.back() = std::move(runs.back());
+        runs = std::move(merged);
+    }
+    return runs.empty() ? std::vector<Keyed>() : std::move(runs[0]);
+}
+
+std::vector<uint32_t> indices_of(const std::vector<Keyed> &keyed) {
+    std::vector<uint32_t> out(keyed.size());
+    for (size_t i = 0; i < keyed.size(); i++) out[i] = keyed[i].index;
+    return out;
+}
+
+}
+
+std::vector<uint32_t> select_rows(const ServiceSnapshot &rows, const QueryMatcher &match,
+                                  size_t first, WorkerPool &pool) {
+    size_t n = rows.size() > first ? rows.size() - first : 0;
+    size_t parts = partitions_for(n, pool);
+    std::vector<std::vector<uint32_t>> found(parts);
+    for_partitions(parts, pool, [&](size_t p) {
+        auto [begin, end] = partition(n, parts, p);
+        for (size_t i = first + begin; i < first + end; i++) {
+            if (match(rows, i)) found[p].push_back(i);
+        }
+    });
+    return concat(found);
+}
+
+std::vector<uint32_t> select_rows(const ServiceSnapshot &rows, const QueryMatcher &match,
+                                  const std::vector<uint32_t> &candidates, WorkerPool &pool) {
+    size_t parts = partitions_for(candidates.size(), pool);
+    std::vector<std::vector<uint32_t>> found(parts);
+    for_partitions(parts, pool, [&](size_t p) {
+        auto [begin, end] = partition(candidates.size(), parts, p);
+        for (size_t i = begin; i < end; i++) {
+            if (match(rows, candidates[i])) found[p].push_back(candidates[i]);
+        }
+    });
+    return concat(found);
+}
+
+void sort_rows(const ServiceSnapshot &rows, const SortOrder &order,
+               std::vector<uint32_t> &indices, WorkerPool &pool) {
+    KeyedBefore before{rows, order};
+    size_t parts = partitions_for(indices.size(), pool);
+    std::vector<std::vector<Keyed>> runs(parts);
+    for_partitions(parts, pool, [&](size_t p) {
+        auto [begin, end] = partition(indices.size(), parts, p);
+        auto &run = runs[p];
+        run.reserve(end - begin);
+        for (size_t i = begin; i < end; i++) run.push_back(keyed(rows, order, indices[i]));
+        std::sort(run.begin(), run.end(), before);
+    });
+    indices = indices_of(merge_runs(std::move(runs), before, pool));
+}
+
+std::vector<uint32_t> run_query(const ServiceSnapshot &rows, const QueryMatcher &match,
+                                const SortOrder &order, size_t first, WorkerPool &pool) {
+    if (order.key == SortKey::ListOrder) return select_rows(rows, match, first, pool);
+    KeyedBefore before{rows, order};
+    size_t n = rows.size() > first ? rows.size() - first : 0;
+    size_t parts = partitions_for(n, pool);
+    std::vector<std::vector<Keyed>> runs(parts);
+    for_partitions(parts, pool, [&](size_t p) {
+        auto [begin, end] = partition(n, parts, p);
+        auto &run = runs[p];
+        for (size_t i = first + begin; i < first + end; i++) {
+            if (match(rows, i)) run.push_back(keyed(rows, order, i));
+        }
+        std::sort(run.begin(), run.end(), before);
+    });
+    return indices_of(merge_runs(std::move(runs), before, pool));
+}
+
+bool row_before(const ServiceSnapshot &rows, const SortOrder &order, uint32_t a, uint32_t b) {
+    KeyedBefore before{rows, order};
+    return before(keyed(rows, order, a), keyed(rows, order, b));
+}
@@ -0,0 +1,285 @@
+#include "../include/query_trace.h"
+#include "../include/json.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+// Log-linear latency buckets over nanoseconds, eight per power of two, so a
+// bucket is at most 1/8 as wide as its values. Everything from 2^40 ns
+// (about 18 minutes) up shares the last bucket.
+constexpr int SUB_BITS = 3;
+constexpr uint64_t SUB = 1 << SUB_BITS;
+constexpr int MAX_BITS = 40;
+constexpr size_t BUCKETS = SUB * (MAX_BITS - SUB_BITS + 1);
+
+size_t bucket_of(uint64_t ns) {
+    if (ns < SUB) return ns;
+    int msb = 63 - __builtin_clzll(ns);
+    if (msb >= MAX_BITS) return BUCKETS - 1;
+    return SUB * (msb - SUB_BITS + 1) + ((ns >> (msb - SUB_BITS)) & (SUB - 1));
+}
+
+// Middle of a bucket's range, in nanoseconds.
+double bucket_value(size_t bucket) {
+    if (bucket < SUB) return double(bucket);
+    int msb = int(bucket / SUB) + SUB_BITS - 1;
+    double width = double(uint64_t(1) << (msb - SUB_BITS));
+    return double(SUB + bucket % SUB) * width + width / 2;
+}
+
+// Distinct names beyond this many are counted together under slot 0.
+constexpr size_t MAX_SLOTS = 512;
+
+struct Slot {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> rows{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::atomic<uint64_t> buckets[BUCKETS]{};
+};
+
+// Written only by the thread that owns it; trace_snapshot() reads it from
+// any thread. Slots are allocated on first use and published with release.
+struct ThreadTable {
+    std::atomic<Slot*> slots[MAX_SLOTS]{};
+
+    ~ThreadTable() {
+        for (auto &slot : slots) delete slot.load();
+    }
+};
+
+// Names of the slots and the table of every thread that recorded. Tables
+// stay after their thread exits, so its numbers still count.
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::pair<std::string, bool>> names{{"(other)", false}};   // name, statement
+    std::unordered_map<std::string, uint32_t> index;
+    std::vector<std::unique_ptr<ThreadTable>> tables;
+};
+
+Registry &registry() {
+    // never destroyed: threads may still record while statics go away
+    static Registry *r = new Registry;
+    return *r;
+}
+
+ThreadTable &own_table() {
+    thread_local ThreadTable *table = [] {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.tables.push_back(std::make_unique<ThreadTable>());
+        return r.tables.back().get();
+    }();
+    return *table;
+}
+
+uint32_t intern(std::string_view name, bool statement) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::string key(name);
+    auto it = r.index.find(key);
+    if (it != r.index.end()) return it->second;
+    if (r.names.size() == MAX_SLOTS) return 0;
+    uint32_t id = uint32_t(r.names.size());
+    r.names.emplace_back(key, statement);
+    r.index.emplace(std::move(key), id);
+    return id;
+}
+
+struct TextHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view sv) const { return std::hash<std::string_view>{}(sv); }
+};
+
+uint32_t statement_slot(std::string_view sql) {
+    thread_local std::unordered_map<std::string, uint32_t, TextHash, std::equal_to<>> cache;
+    auto it = cache.find(sql);
+    if (it != cache.end()) return it->second;
+    uint32_t id = intern(sql, true);
+    cache.emplace(std::string(sql), id);
+    return id;
+}
+
+uint32_t call_slot(const char *name) {
+    thread_local std::unordered_map<const char*, uint32_t> cache;
+    auto it = cache.find(name);
+    if (it != cache.end()) return it->second;
+    uint32_t id = intern(name, false);
+    cache.emplace(name, id);
+    return id;
+}
+
+// Only the owning thread writes a slot, so a load and a store do; the
+// atomics just keep the concurrent reads in trace_snapshot() defined.
+void bump(std::atomic<uint64_t> &counter, uint64_t by) {
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+void record(uint32_t id, uint64_t ns, uint64_t rows) {
+    ThreadTable &table = own_table();
+    Slot *slot = table.slots[id].load(std::memory_order_relaxed);
+    if (!slot) {
+        slot = new Slot;
+        table.slots[id].store(slot, std::memory_order_release);
+    }
+    bump(slot->count, 1);
+    bump(slot->rows, rows);
+    bump(slot->total_ns, ns);
+    if (ns > slot->max_ns.load(std::memory_order_relaxed)) slot->max_ns.store(ns, std::memory_order_relaxed);
+    bump(slot->buckets[bucket_of(ns)], 1);
+}
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// A statement that started on this thread and has not finished yet.
+struct Running {
+    sqlite3_stmt *stmt;
+    int64_t start_ns;
+    uint64_t rows;
+};
+
+int on_trace(unsigned type, void *, void *p, void *x) {
+    auto *stmt = static_cast<sqlite3_stmt*>(p);
+    // rarely more than one or two at a time
+    thread_local std::vector<Running> running;
+    auto it = std::find_if(running.begin(), running.end(), [stmt](const Running &r) { return r.stmt == stmt; });
+    switch (type) {
+        case SQLITE_TRACE_STMT:
+            // also fires for each trigger the statement runs; keep the first
+            if (it == running.end()) running.push_back(Running{stmt, now_ns(), 0});
+            return 0;
+        case SQLITE_TRACE_ROW:
+            if (it != running.end()) it->rows++;
+            return 0;
+        case SQLITE_TRACE_PROFILE:
+            break;
+        default:
+            return 0;
+    }
+    // SQLite's own figure only has the VFS clock's millisecond resolution
+    uint64_t ns = uint64_t(*static_cast<sqlite3_int64*>(x));
+    uint64_t rows = 0;
+    if (it != running.end()) {
+        ns = uint64_t(now_ns() - it->start_ns);
+        rows = it->rows;
+        running.erase(it);
+    }
+    const char *sql = sqlite3_sql(stmt);
+    record(statement_slot(sql ? sql : ""), ns, rows);
+    return 0;
+}
+
+double percentile(const std::vector<uint64_t> &buckets, uint64_t total, double p) {
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(p * total)));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < buckets.size(); b++) {
+        seen += buckets[b];
+        if (seen >= rank) return bucket_value(b);
+    }
+    return 0;
+}
+
+}
+
+void trace_statements(sqlite3 *db) {
+    sqlite3_trace_v2(db, SQLITE_TRACE_STMT | SQLITE_TRACE_ROW | SQLITE_TRACE_PROFILE, on_trace, nullptr);
+}
+
+TraceScope::TraceScope(const char *name_) : name(name_), start_ns(now_ns()) {}
+
+TraceScope::~TraceScope() {
+    record(call_slot(name), uint64_t(now_ns() - start_ns), row_count);
+}
+
+std::vector<TraceStats> trace_snapshot() {
+    std::vector<std::pair<std::string, bool>> names;
+    std::vector<const ThreadTable*> tables;
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        names = r.names;
+        for (const auto &t : r.tables) tables.push_back(t.get());
+    }
+
+    std::vector<TraceStats> out;
+    std::vector<uint64_t> buckets(BUCKETS);
+    for (size_t id = 0; id < names.size(); id++) {
+        TraceStats s;
+        s.name = names[id].first;
+        s.statement = names[id].second;
+        std::fill(buckets.begin(), buckets.end(), 0);
+        uint64_t total_ns = 0, max_ns = 0, counted = 0;
+        for (const ThreadTable *t : tables) {
+            const Slot *slot = t->slots[id].load(std::memory_order_acquire);
+            if (!slot) continue;
+            s.count += slot->count.load(std::memory_order_relaxed);
+            s.rows += slot->rows.load(std::memory_order_relaxed);
+            total_ns += slot->total_ns.load(std::memory_order_relaxed);
+            max_ns = std::max(max_ns, slot->max_ns.load(std::memory_order_relaxed));
+            for (size_t b = 0; b < BUCKETS; b++) {
+                uint64_t n = slot->buckets[b].load(std::memory_order_relaxed);
+                buckets[b] += n;
+                counted += n;
+            }
+        }
+        if (s.count == 0) continue;
+        s.total_ms = total_ns / 1e6;
+        s.max_us = max_ns / 1e3;
+        // a bucket's midpoint can lie past the largest value it holds
+        s.p50_us = std::min(percentile(buckets, counted, 0.50) / 1e3, s.max_us);
+        s.p95_us = std::min(percentile(buckets, counted, 0.95) / 1e3, s.max_us);
+        s.p99_us = std::min(percentile(buckets, counted, 0.99) / 1e3, s.max_us);
+        out.push_back(std::move(s));
+    }
+    std::sort(out.begin(), out.end(), [](const TraceStats &a, const TraceStats &b) {
+        return a.total_ms > b.total_ms;
+    });
+    return out;
+}
+
+std::string trace_json() {
+    std::vector<TraceStats> stats = trace_snapshot();
+    std::string out = "{\n";
+    for (bool statements : {false, true}) {
+        out += statements ? "  \"statements\": [" : "  \"calls\": [";
+        bool first = true;
+        for (const auto &s : stats) {
+            if (s.statement != statements) continue;
+            char numbers[256];
+            snprintf(numbers, sizeof numbers,
+                     "\"count\": %llu, \"rows\": %llu, \"total_ms\": %.3f, \"p50_us\": %.1f, "
+                     "\"p95_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f}",
+                     (unsigned long long)s.count, (unsigned long long)s.rows, s.total_ms,
+                     s.p50_us, s.p95_us, s.p99_us, s.max_us);
+            out += first ? "\n" : ",\n";
+            out += "    {\"name\": " + json_string(s.name) + ", " + numbers;
+            first = false;
+        }
+        out += statements ? "\n  ]\n" : "\n  ],\n";
+    }
+    return out + "}\n";
+}
+
+bool dump_trace(const std::string &path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (file) file << trace_json();
+    if (!file) {
+        std::cerr << "dump_trace: cannot write " << path << "\n";
+        return false;
+    }
+    return true;
+}
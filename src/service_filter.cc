@@ -0,0 +1,183 @@
+#include "../include/service_filter.h"
+#include "../include/parallel_query.h"
+#include <algorithm>
+
+// Past this many separate edits a single "replace everything" is cheaper
+// for both us and the ListView than splicing each run in turn.
+static constexpr size_t MAX_CHANGES = 32;
+
+static bool accepts_all(const std::string &status) {
+    return status.empty() || status == "all";
+}
+
+QueryMatcher::QueryMatcher(const ServiceQuery &query)
+: any_status(accepts_all(query.status)),
+  want(any_status ? ServiceStatus::Unknown : status_code(query.status)),
+  text(query.text) {}
+
+bool ServiceQuery::matches(const ServiceSnapshot &rows, uint32_t index) const {
+    return QueryMatcher(*this)(rows, index);
+}
+
+bool ServiceQuery::narrows(const ServiceQuery &prev) const {
+    // every text containing the new needle also contains the old one
+    if (fold_text(text).find(fold_text(prev.text)) == std::string::npos) return false;
+    return accepts_all(prev.status) || prev.status == status;
+}
+
+void ServiceFilter::reset(const ServiceSnapshot &rows) {
+    matched = run_query(rows, QueryMatcher(query), order, 0, query_pool());
+}
+
+void ServiceFilter::extend(const ServiceSnapshot &rows, size_t first,
+                           const std::function<void(const FilterChange&)> &on_change) {
+    std::vector<uint32_t> more = run_query(rows, QueryMatcher(query), order, first, query_pool());
+    if (more.empty()) return;
+    if (list_order()) {
+        uint32_t position = matched.size();
+        matched.insert(matched.end(), more.begin(), more.end());
+        on_change(FilterChange{position, 0, (uint32_t)more.size()});
+        return;
+    }
+    std::vector<uint32_t> result(matched.size() + more.size());
+    std::merge(matched.begin(), matched.end(), more.begin(), more.end(), result.begin(),
+               [&](uint32_t a, uint32_t b) { return row_before(rows, order, a, b); });
+    replace_all(std::move(result), on_change);
+}
+
+void ServiceFilter::replace_all(std::vector<uint32_t> result,
+                                const std::function<void(const FilterChange&)> &on_change) {
+    uint32_t removed = matched.size();
+    matched = std::move(result);
+    on_change(FilterChange{0, removed, (uint32_t)matched.size()});
+}
+
+void ServiceFilter::set_order(const ServiceSnapshot &rows, const SortOrder &next,
+                              const std::function<void(const FilterChange&)> &on_change) {
+    if (next == order) return;
+    order = next;
+    if (matched.empty()) return;
+    std::vector<uint32_t> result = matched;
+    sort_rows(rows, order, result, query_pool());
+    replace_all(std::move(result), on_change);
+}
+
+uint32_t ServiceFilter::position_for(const ServiceSnapshot &rows, uint32_t index) const {
+    if (list_order()) return std::lower_bound(matched.begin(), matched.end(), index) - matched.begin();
+    return std::partition_point(matched.begin(), matched.end(), [&](uint32_t m) {
+        return row_before(rows, order, m, index);
+    }) - matched.begin();
+}
+
+void ServiceFilter::update(const ServiceSnapshot &rows, const ServiceQuery &next,
+                           const std::function<void(const FilterChange&)> &on_change) {
+    if (next == query) return;
+
+    // narrowing keeps the current order, so only the list needs filtering
+    QueryMatcher match(next);
+    std::vector<uint32_t> result = next.narrows(query)
+        ? select_rows(rows, match, matched, query_pool())
+        : run_query(rows, match, order, 0, query_pool());
+    query = next;
+    if (!list_order()) {
+        if (result != matched) replace_all(std::move(result), on_change);
+        return;
+    }
+
+    // Both lists are ascending row indices, so a merge walk yields the runs
+    // that differ. old_pos/new_pos are where each run starts in either list.
+    struct Run { uint32_t old_pos, removed, new_pos, added; };
+    std::vector<Run> runs;
+    size_t i = 0, j = 0;
+    while (i < matched.size() || j < result.size()) {
+        if (i < matched.size() && j < result.size() && matched[i] == result[j]) {
+            i++; j++;
+            continue;
+        }
+        Run run{(uint32_t)i, 0, (uint32_t)j, 0};
+        while ((i < matched.size() || j < result.size()) &&
+               !(i < matched.size() && j < result.size() && matched[i] == result[j])) {
+            if (j >= result.size() || (i < matched.size() && matched[i] < result[j])) i++;
+            else j++;
+        }
+        run.removed = i - run.old_pos;
+        run.added = j - run.new_pos;
+        runs.push_back(run);
+    }
+    if (runs.empty()) return;
+
+    if (runs.size() > MAX_CHANGES) {
+        uint32_t removed = matched.size();
+        matched = std::move(result);
+        on_change(FilterChange{0, removed, (uint32_t)matched.size()});
+        return;
+    }
+
+    // Apply back to front: positions in front of a run are still the old
+    // ones, so every intermediate list is a valid model state.
+    for (auto it = runs.rbegin(); it != runs.rend(); ++it) {
+        matched.erase(matched.begin() + it->old_pos, matched.begin() + it->old_pos + it->removed);
+        matched.insert(matched.begin() + it->old_pos,
+                       result.begin() + it->new_pos, result.begin() + it->new_pos + it->added);
+        on_change(FilterChange{it->old_pos, it->removed, it->added});
+    }
+}
+
+void ServiceFilter::refresh(const ServiceSnapshot &rows, uint32_t index,
+                            const std::function<void(const FilterChange&)> &on_change) {
+    bool now = query.matches(rows, index);
+    if (list_order()) {
+        auto it = std::lower_bound(matched.begin(), matched.end(), index);
+        uint32_t position = it - matched.begin();
+        bool was = it != matched.end() && *it == index;
+        if (was && now) {
+            on_change(FilterChange{position, 1, 1});
+        } else if (was) {
+            matched.erase(it);
+            on_change(FilterChange{position, 1, 0});
+        } else if (now) {
+            matched.insert(it, index);
+            on_change(FilterChange{position, 0, 1});
+        }
+        return;
+    }
+    // the edit may have moved the row, so take it out and place it again
+    auto it = std::find(matched.begin(), matched.end(), index);
+    uint32_t old_position = it - matched.begin();
+    bool was = it != matched.end();
+    if (was) matched.erase(it);
+    uint32_t position = now ? position_for(rows, index) : 0;
+    if (was && now && position == old_position) {
+        matched.insert(matched.begin() + position, index);
+        on_change(FilterChange{position, 1, 1});
+        return;
+    }
+    if (was) on_change(FilterChange{old_position, 1, 0});
+    if (now) {
+        matched.insert(matched.begin() + position, index);
+        on_change(FilterChange{position, 0, 1});
+    }
+}
+
+void ServiceFilter::insert(const ServiceSnapshot &rows, uint32_t index,
+                           const std::function<void(const FilterChange&)> &on_change) {
+    for (auto &m : matched) {
+        if (m >= index) m++;
+    }
+    if (!query.matches(rows, index)) return;
+    uint32_t position = position_for(rows, index);
+    matched.insert(matched.begin() + position, index);
+    on_change(FilterChange{position, 0, 1});
+}
+
+void ServiceFilter::erase(uint32_t index, const std::function<void(const FilterChange&)> &on_change) {
+    auto it = list_order() ? std::lower_bound(matched.begin(), matched.end(), index)
+                           : std::find(matched.begin(), matched.end(), index);
+    uint32_t position = it - matched.begin();
+    bool was = it != matched.end() && *it == index;
+    if (was) matched.erase(it);
+    for (auto &m : matched) {
+        if (m > index) m--;
+    }
+    if (was) on_change(FilterChange{position, 1, 0});
+}
@@ -0,0 +1,278 @@
+#include "../include/service_list.h"
+#include <algorithm>
+
+static constexpr int SERVICE_PAGE_SIZE = 200;
+static constexpr unsigned FILTER_DEBOUNCE_MS = 150;
+static constexpr int SEARCH_LIMIT = 500;
+
+Glib::RefPtr<ServiceItem> ServiceItem::create(const ServiceSummary &row) {
+    return Glib::make_refptr_for_instance<ServiceItem>(new ServiceItem(row));
+}
+
+ServiceItem::ServiceItem(const ServiceSummary &row_) : row(row_) {}
+
+Glib::RefPtr<ServiceListModel> ServiceListModel::create() {
+    return Glib::make_refptr_for_instance<ServiceListModel>(new ServiceListModel());
+}
+
+ServiceListModel::ServiceListModel()
+: Glib::ObjectBase(typeid(ServiceListModel)), Gio::ListModel(), Glib::Object() {}
+
+GType ServiceListModel::get_item_type_vfunc() {
+    return Glib::Object::get_base_type();
+}
+
+guint ServiceListModel::get_n_items_vfunc() {
+    return filter.matches().size();
+}
+
+gpointer ServiceListModel::get_item_vfunc(guint position) {
+    const ServiceSummary *row = row_at(position);
+    if (!row) return nullptr;
+    auto item = ServiceItem::create(*row);
+    return item->gobj_copy();
+}
+
+const ServiceSummary *ServiceListModel::row_at(guint position) const {
+    auto &visible = filter.matches();
+    if (position >= visible.size()) return nullptr;
+    return &rows[visible[position]];
+}
+
+void ServiceListModel::set_rows(std::vector<ServiceSummary> rows_) {
+    guint removed = filter.matches().size();
+    rows = std::move(rows_);
+    columns.reset(rows);
+    position_of.clear();
+    reindex(0);
+    filter.reset(columns);
+    items_changed(0, removed, filter.matches().size());
+}
+
+void ServiceListModel::append_rows(const std::vector<ServiceSummary> &more) {
+    size_t first = rows.size();
+    rows.insert(rows.end(), more.begin(), more.end());
+    for (const auto &row : more) columns.append(row);
+    reindex(first);
+    filter.extend(columns, first, [this](const FilterChange &c) { forward(c); });
+}
+
+void ServiceListModel::set_query(const ServiceQuery &query) {
+    filter.update(columns, query, [this](const FilterChange &c) { forward(c); });
+}
+
+void ServiceListModel::set_order(const SortOrder &order) {
+    filter.set_order(columns, order, [this](const FilterChange &c) { forward(c); });
+}
+
+bool ServiceListModel::update_row(const ServiceSummary &row) {
+    auto it = position_of.find(row.service_id);
+    if (it == position_of.end()) return false;
+    rows[it->second] = row;
+    columns.assign(it->second, row);
+    filter.refresh(columns, it->second, [this](const FilterChange &c) { forward(c); });
+    return true;
+}
+
+// Same order as the pages: created_at, then service_id, both descending.
+static bool sorts_before(const ServiceSummary &a, const ServiceSummary &b) {
+    if (a.created_at != b.created_at) return a.created_at > b.created_at;
+    return a.service_id > b.service_id;
+}
+
+void ServiceListModel::insert_row(const ServiceSummary &row) {
+    if (update_row(row)) return;
+    auto at = std::lower_bound(rows.begin(), rows.end(), row, sorts_before);
+    size_t index = at - rows.begin();
+    rows.insert(at, row);
+    columns.insert(index, row);
+    reindex(index);
+    filter.insert(columns, index, [this](const FilterChange &c) { forward(c); });
+}
+
+bool ServiceListModel::past_end(const ServiceSummary &row) const {
+    return !rows.empty() && sorts_before(rows.back(), row);
+}
+
+void ServiceListModel::remove_row(int service_id) {
+    auto it = position_of.find(service_id);
+    if (it == position_of.end()) return;
+    uint32_t index = it->second;
+    position_of.erase(it);
+    rows.erase(rows.begin() + index);
+    columns.erase(index);
+    reindex(index);
+    filter.erase(index, [this](const FilterChange &c) { forward(c); });
+}
+
+void ServiceListModel::reindex(size_t first) {
+    for (size_t i = first; i < rows.size(); i++) position_of[rows[i].service_id] = i;
+}
+
+ServiceRowBase::ServiceRowBase() : Gtk::Box(Gtk::Orientation::HORIZONTAL, 6) {
+    get_style_context()->add_class("row");
+    label.set_halign(Gtk::Align::START);
+    label.set_hexpand(true);
+    append(label);
+}
+
+void ServiceRowBase::bind(const ServiceSummary &s) {
+    service = s;
+    label.set_text("#" + std::to_string(s.service_id) + "   " + s.client_name + "   " + status_name(s.status));
+}
+
+ServiceListView::ServiceListView(std::function<ServiceRowBase*()> create_row)
+: model(ServiceListModel::create())
+{
+    auto factory = Gtk::SignalListItemFactory::create();
+    factory->signal_setup().connect([create_row](const Glib::RefPtr<Gtk::ListItem>& list_item) {
+        list_item->set_child(*create_row());
+    });
+    factory->signal_bind().connect([](const Glib::RefPtr<Gtk::ListItem>& list_item) {
+        auto item = std::dynamic_pointer_cast<ServiceItem>(list_item->get_item());
+        auto row = dynamic_cast<ServiceRowBase*>(list_item->get_child());
+        if (item && row) row->bind(item->row);
+    });
+
+    list.set_model(Gtk::NoSelection::create(model));
+    list.set_factory(factory);
+    list.set_show_separators(true);
+
+    set_child(list);
+    set_policy(Gtk::PolicyType::NEVER, Gtk::PolicyType::AUTOMATIC);
+    set_vexpand(true);
+
+    signal_edge_reached().connect([this](Gtk::PositionType pos) {
+        if (pos == Gtk::PositionType::BOTTOM) load_more();
+    });
+}
+
+ServiceListView::~ServiceListView() {
+    pending_query.disconnect();
+    if (repository) repository->unsubscribe(subscription);
+}
+
+void ServiceListView::set_repository(ServiceRepository *repository_) {
+    if (repository) repository->unsubscribe(subscription);
+    repository = repository_;
+    if (repository) {
+        subscription = repository->subscribe([this](ServiceRepository::Change change, const ServiceSummary &row) {
+            on_repository_change(change, row);
+        });
+    }
+}
+
+void ServiceListView::on_repository_change(ServiceRepository::Change change, const ServiceSummary &row) {
+    switch (change) {
+        case ServiceRepository::Change::Added:
+            // new services are unassigned, so they belong in the full list;
+            // the model's query decides whether a filtered list shows them
+            if (executor && assigned_to == 0) show_row(row);
+            break;
+        case ServiceRepository::Change::Updated:
+            if (model->update_row(row)) break;
+            // a technician's list gains the services newly assigned to them
+            if (executor && assigned_to != 0) {
+                auto ids = repository->assigned_to(assigned_to);
+                if (std::find(ids.begin(), ids.end(), row.service_id) != ids.end()) show_row(row);
+            }
+            break;
+        case ServiceRepository::Change::Removed:
+            model->remove_row(row.service_id);
+            break;
+    }
+}
+
+void ServiceListView::show_row(const ServiceSummary &row) {
+    if (!created.contains(row.created_at)) return;
+    // rows beyond the loaded pages arrive with load_more()
+    if (next && model->past_end(row)) return;
+    model->insert_row(row);
+}
+
+void ServiceListView::load(DbExecutor *executor_, int only_assigned_to, const TimeRange &created_) {
+    executor = executor_;
+    assigned_to = only_assigned_to;
+    created = created_;
+    search_text.clear();
+    loading = true;
+    unsigned gen = ++generation;
+    executor->run_read([assigned = assigned_to, range = created](sqlite3 *db) {
+        return std::make_pair(get_services_page(db, assigned, std::nullopt, SERVICE_PAGE_SIZE, range),
+                              search_available(db));
+    }, [this, gen](std::pair<ServicePage, bool> result) {
+        if (gen != generation) return;
+        loading = false;
+        fts = result.second;
+        next = result.first.next;
+        if (repository) repository->remember(result.first.rows, assigned_to);
+        model->set_rows(std::move(result.first.rows));
+        if (fts && next && !filter_text.empty()) search(filter_text);
+    });
+}
+
+// TextMatcher over the snapshot is what filters the list; the full-text
+// index only fetches the rows that are not loaded yet.
+void ServiceListView::set_filter(const std::string &text, const std::string &status) {
+    filter_text = text;
+    // the loaded rows narrow or widen in place first, one edit per run of
+    // rows that changed
+    model->set_query(ServiceQuery{text, status});
+    if (!executor || text == search_text) return;
+    if (text.empty()) {
+        // drop the rows a search added past the loaded pages
+        if (!search_text.empty()) load(executor, assigned_to, created);
+        return;
+    }
+    // with every page loaded there is nothing left to find
+    if (fts && (next || !search_text.empty())) search(text);
+}
+
+void ServiceListView::set_created_range(const TimeRange &created_) {
+    if (!executor || created_ == created) return;
+    load(executor, assigned_to, created_);
+}
+
+void ServiceListView::search(const std::string &text) {
+    search_text = text;
+    // the list no longer ends where the pages do; paging resumes once the
+    // text is cleared
+    next.reset();
+    loading = true;
+    unsigned gen = ++generation;
+    executor->run_read([text, range = created](sqlite3 *db) {
+        return search_services(text, SEARCH_LIMIT, range, db);
+    }, [this, gen](std::vector<ServiceSummary> rows) {
+        if (gen != generation) return;
+        loading = false;
+        if (repository) repository->remember(rows);
+        // rows already loaded keep their place; the rest go in list order,
+        // each shown only if it passes the current query
+        for (const auto &row : rows) {
+            if (!model->contains(row.service_id)) model->insert_row(row);
+        }
+    });
+}
+
+void ServiceListView::set_filter_debounced(const std::string &text, const std::string &status) {
+    pending_query.disconnect();
+    pending_query = Glib::signal_timeout().connect([this, text, status]() {
+        set_filter(text, status);
+        return false;
+    }, FILTER_DEBOUNCE_MS);
+}
+
+void ServiceListView::load_more() {
+    if (!executor || !next || loading) return;
+    loading = true;
+    unsigned gen = generation;
+    executor->run_read([assigned = assigned_to, after = next, range = created](sqlite3 *db) {
+        return get_services_page(db, assigned, after, SERVICE_PAGE_SIZE, range);
+    }, [this, gen](ServicePage page) {
+        if (gen != generation) return;
+        loading = false;
+        next = page.next;
+        if (repository) repository->remember(page.rows, assigned_to);
+        model->append_rows(page.rows);
+    });
+}
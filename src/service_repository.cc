@@ -0,0 +1,181 @@
+#include "../include/service_repository.h"
+#include <algorithm>
+
+ServiceRepository::ServiceRepository(DbExecutor &executor_, ChangeFeed &feed_)
+: executor(executor_), feed(feed_)
+{
+    subscription = feed.subscribe([this](const ChangeSet &changes) { apply(changes); });
+}
+
+ServiceRepository::~ServiceRepository() {
+    feed.unsubscribe(subscription);
+}
+
+void ServiceRepository::remember(const std::vector<ServiceSummary> &rows, int technician_id) {
+    for (const auto &row : rows) {
+        store(row);
+        if (technician_id > 0) {
+            by_technician[technician_id].insert(row.service_id);
+            technicians_of[row.service_id].insert(technician_id);
+        }
+    }
+}
+
+const ServiceSummary *ServiceRepository::find(int service_id) const {
+    auto it = by_id.find(service_id);
+    return it == by_id.end() ? nullptr : &it->second;
+}
+
+std::vector<int> ServiceRepository::with_status(ServiceStatus status) const {
+    const auto &ids = by_status[size_t(status)];
+    return std::vector<int>(ids.begin(), ids.end());
+}
+
+std::vector<int> ServiceRepository::assigned_to(int technician_id) const {
+    auto it = by_technician.find(technician_id);
+    if (it == by_technician.end()) return {};
+    return std::vector<int>(it->second.begin(), it->second.end());
+}
+
+void ServiceRepository::get(int service_id, std::function<void(std::optional<ServiceRow>)> done) {
+    executor.run_read([service_id](sqlite3 *db) { return get_service_by_id(service_id, db); },
+                      [this, done](std::optional<ServiceRow> row) {
+        if (row) store(*row);
+        done(std::move(row));
+    });
+}
+
+void ServiceRepository::add(const ServiceRow &row, int created_by_id, std::function<void(bool)> done) {
+    executor.run_write([row, created_by_id](sqlite3 *db) {
+        return add_service(row.client_name, row.phone_number, row.email, row.equipment,
+                           row.problem_report, created_by_id, db);
+    }, done);
+}
+
+void ServiceRepository::update(const ServiceRow &row, int edited_by_id, std::function<void(bool)> done) {
+    executor.run_write([row, edited_by_id](sqlite3 *db) { return edit_service(row, edited_by_id, db); }, done);
+}
+
+void ServiceRepository::remove(int service_id, std::function<void(bool)> done) {
+    executor.run_write([service_id](sqlite3 *db) { return delete_service(service_id, db); }, done);
+}
+
+void ServiceRepository::assign(int service_id, int technician_id, std::function<void(bool)> done) {
+    executor.run_write([service_id, technician_id](sqlite3 *) {
+        return assign_technician(technician_id, service_id);
+    }, done);
+}
+
+namespace {
+struct Delta {
+    std::vector<std::pair<int, int>> assignments;   // (service_id, technician_id)
+    std::vector<std::pair<ServiceSummary, bool>> rows;  // row, whether it was inserted
+};
+}
+
+void ServiceRepository::apply(const ChangeSet &changes) {
+    unsigned gen = ++generation;
+    std::vector<std::pair<int, bool>> changed;
+    std::vector<sqlite3_int64> assigned;
+    for (const auto &c : changes) {
+        if (c.table == "services") {
+            int service_id = int(c.rowid);
+            last_change[service_id] = gen;
+            if (c.op != ChangeOp::Delete) {
+                changed.emplace_back(service_id, c.op == ChangeOp::Insert);
+                continue;
+            }
+            ServiceSummary removed;
+            if (const ServiceSummary *row = find(service_id)) removed = *row;
+            removed.service_id = service_id;
+            forget(service_id);
+            notify(Change::Removed, removed);
+        } else if (c.table == "service_technicians" && c.op == ChangeOp::Insert) {
+            assigned.push_back(c.rowid);
+        } else if (c.table == "users" && c.op == ChangeOp::Delete) {
+            forget_technician(int(c.rowid));
+        }
+    }
+    if (changed.empty() && assigned.empty()) {
+        // only deletes; they guard the rows against older reads still on their way
+        if (reads_in_flight == 0) last_change.clear();
+        return;
+    }
+
+    reads_in_flight++;
+    executor.run_read([changed, assigned](sqlite3 *db) mutable {
+        Delta delta;
+        for (sqlite3_int64 rowid : assigned) {
+            auto assignment = get_assignment(rowid, db);
+            if (!assignment) continue;
+            delta.assignments.push_back(*assignment);
+            // the technician's list needs the row to show it
+            int service_id = assignment->first;
+            bool listed = std::any_of(changed.begin(), changed.end(),
+                                      [service_id](const auto &c) { return c.first == service_id; });
+            if (!listed) changed.emplace_back(service_id, false);
+        }
+        for (auto [service_id, inserted] : changed) {
+            if (auto row = get_service_summary(service_id, db)) delta.rows.emplace_back(std::move(*row), inserted);
+        }
+        return delta;
+    }, [this, gen](Delta delta) {
+        for (auto [service_id, technician_id] : delta.assignments) {
+            by_technician[technician_id].insert(service_id);
+            technicians_of[service_id].insert(technician_id);
+        }
+        for (const auto &[row, inserted] : delta.rows) {
+            // a later change to this row is already applied or on its way
+            auto it = last_change.find(row.service_id);
+            if (it != last_change.end() && it->second != gen) continue;
+            store(row);
+            notify(inserted ? Change::Added : Change::Updated, row);
+        }
+        if (--reads_in_flight == 0) last_change.clear();
+        else std::erase_if(last_change, [gen](const auto &entry) { return entry.second == gen; });
+    });
+}
+
+size_t ServiceRepository::subscribe(Listener listener) {
+    listeners.emplace(next_handle, std::move(listener));
+    return next_handle++;
+}
+
+void ServiceRepository::unsubscribe(size_t handle) {
+    listeners.erase(handle);
+}
+
+void ServiceRepository::store(const ServiceSummary &row) {
+    auto [it, inserted] = by_id.try_emplace(row.service_id, row);
+    if (!inserted) {
+        if (it->second.status != row.status) by_status[size_t(it->second.status)].erase(row.service_id);
+        it->second = row;
+    }
+    by_status[size_t(row.status)].insert(row.service_id);
+}
+
+void ServiceRepository::forget(int service_id) {
+    auto it = by_id.find(service_id);
+    if (it != by_id.end()) {
+        by_status[size_t(it->second.status)].erase(service_id);
+        by_id.erase(it);
+    }
+    auto techs = technicians_of.find(service_id);
+    if (techs != technicians_of.end()) {
+        for (int tech : techs->second) by_technician[tech].erase(service_id);
+        technicians_of.erase(techs);
+    }
+}
+
+void ServiceRepository::forget_technician(int technician_id) {
+    auto services = by_technician.find(technician_id);
+    if (services == by_technician.end()) return;
+    for (int service_id : services->second) technicians_of[service_id].erase(technician_id);
+    by_technician.erase(services);
+}
+
+void ServiceRepository::notify(Change change, const ServiceSummary &row) {
+    // a listener may unsubscribe while we iterate
+    auto snapshot = listeners;
+    for (auto &[handle, listener] : snapshot) listener(change, row);
+}
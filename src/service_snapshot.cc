@@ -0,0 +1,162 @@
+#include "../include/service_snapshot.h"
+#include "../include/text_match.h"
+#include <algorithm>
+
+static_assert(StringColumn::PADDING >= TextMatcher::PADDING);
+
+void StringColumn::clear() {
+    arena.assign(PADDING, '\0');
+    offset.clear();
+    length.clear();
+    garbage = 0;
+}
+
+void StringColumn::reserve(size_t rows, size_t bytes) {
+    offset.reserve(rows);
+    length.reserve(rows);
+    arena.reserve(bytes + PADDING);
+}
+
+uint32_t StringColumn::store(std::string_view s) {
+    // Past half garbage, rewriting the live strings is cheaper than growing.
+    if (garbage > bytes() / 2 && garbage > 4096) compact();
+    uint32_t at = bytes();
+    arena.resize(at);
+    arena.append(s);
+    arena.append(PADDING, '\0');
+    return at;
+}
+
+void StringColumn::push_back(std::string_view s) {
+    offset.push_back(store(s));
+    length.push_back(s.size());
+}
+
+void StringColumn::insert(uint32_t index, std::string_view s) {
+    uint32_t at = store(s);
+    offset.insert(offset.begin() + index, at);
+    length.insert(length.begin() + index, s.size());
+}
+
+void StringColumn::assign(uint32_t index, std::string_view s) {
+    if (s.size() <= length[index]) {
+        // shrink in place
+        std::copy(s.begin(), s.end(), arena.begin() + offset[index]);
+        garbage += length[index] - s.size();
+        length[index] = s.size();
+        return;
+    }
+    uint32_t at = store(s);
+    garbage += length[index];
+    offset[index] = at;
+    length[index] = s.size();
+}
+
+void StringColumn::erase(uint32_t index) {
+    garbage += length[index];
+    offset.erase(offset.begin() + index);
+    length.erase(length.begin() + index);
+}
+
+void StringColumn::compact() {
+    std::string packed;
+    packed.reserve(arena.size() - garbage);
+    for (size_t i = 0; i < offset.size(); i++) {
+        uint32_t at = packed.size();
+        packed.append(arena, offset[i], length[i]);
+        offset[i] = at;
+    }
+    packed.append(PADDING, '\0');
+    arena.swap(packed);
+    garbage = 0;
+}
+
+void ServiceSnapshot::reset(const std::vector<ServiceSummary> &rows) {
+    service_id.clear();
+    status_.clear();
+    created_.clear();
+    technician_.clear();
+    technician_ids.assign(1, 0);
+    technician_codes.clear();
+    names.clear();
+    phones.clear();
+    emails.clear();
+
+    size_t name_bytes = 0, phone_bytes = 0, email_bytes = 0;
+    for (const auto &row : rows) {
+        name_bytes += row.client_name.size();
+        phone_bytes += row.phone_number.size();
+        email_bytes += row.email.size();
+    }
+    service_id.reserve(rows.size());
+    status_.reserve(rows.size());
+    created_.reserve(rows.size());
+    technician_.reserve(rows.size());
+    names.reserve(rows.size(), name_bytes);
+    phones.reserve(rows.size(), phone_bytes);
+    emails.reserve(rows.size(), email_bytes);
+    for (const auto &row : rows) append(row);
+}
+
+void ServiceSnapshot::append(const ServiceSummary &row) {
+    service_id.push_back(row.service_id);
+    status_.push_back(row.status);
+    created_.push_back(row.created_at);
+    technician_.push_back(intern_technician(row.technician_id));
+    names.push_back(fold_text(row.client_name));
+    phones.push_back(fold_text(row.phone_number));
+    emails.push_back(fold_text(row.email));
+}
+
+void ServiceSnapshot::insert(uint32_t index, const ServiceSummary &row) {
+    service_id.insert(service_id.begin() + index, row.service_id);
+    status_.insert(status_.begin() + index, row.status);
+    created_.insert(created_.begin() + index, row.created_at);
+    technician_.insert(technician_.begin() + index, intern_technician(row.technician_id));
+    names.insert(index, fold_text(row.client_name));
+    phones.insert(index, fold_text(row.phone_number));
+    emails.insert(index, fold_text(row.email));
+}
+
+void ServiceSnapshot::assign(uint32_t index, const ServiceSummary &row) {
+    service_id[index] = row.service_id;
+    status_[index] = row.status;
+    created_[index] = row.created_at;
+    technician_[index] = intern_technician(row.technician_id);
+    names.assign(index, fold_text(row.client_name));
+    phones.assign(index, fold_text(row.phone_number));
+    emails.assign(index, fold_text(row.email));
+}
+
+void ServiceSnapshot::erase(uint32_t index) {
+    service_id.erase(service_id.begin() + index);
+    status_.erase(status_.begin() + index);
+    created_.erase(created_.begin() + index);
+    technician_.erase(technician_.begin() + index);
+    names.erase(index);
+    phones.erase(index);
+    emails.erase(index);
+}
+
+uint32_t ServiceSnapshot::find_technician(int technician_id) const {
+    auto it = technician_codes.find(technician_id);
+    return it == technician_codes.end() ? NO_TECHNICIAN : it->second;
+}
+
+uint32_t ServiceSnapshot::intern_technician(int technician_id) {
+    if (technician_id == 0) return NO_TECHNICIAN;
+    auto [it, added] = technician_codes.try_emplace(technician_id, uint32_t(technician_ids.size()));
+    if (added) technician_ids.push_back(technician_id);
+    return it->second;
+}
+
+size_t ServiceSnapshot::memory_used() const {
+    return service_id.capacity() * sizeof(int32_t)
+         + status_.capacity() * sizeof(ServiceStatus)
+         + created_.capacity() * sizeof(int64_t)
+         + technician_.capacity() * sizeof(uint32_t)
+         + technician_ids.capacity() * sizeof(int)
+         // a hash node per technician, plus its bucket
+         + technician_codes.size() * (sizeof(int) + sizeof(uint32_t) + 2 * sizeof(void*))
+         + names.memory_used() + phones.memory_used() + emails.memory_used();
+}
@@ -0,0 +1,76 @@
+#include "../include/stmt_cache.h"
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct StmtCacheEntry {
+    sqlite3_stmt *stmt = nullptr;
+    bool in_use = false;
+};
+
+namespace {
+
+struct SqlHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view sv) const { return std::hash<std::string_view>{}(sv); }
+};
+
+using StmtMap = std::unordered_map<std::string, StmtCacheEntry, SqlHash, std::equal_to<>>;
+
+std::mutex cache_mutex;
+std::unordered_map<sqlite3*, StmtMap> caches;
+
+}
+
+CachedStmt::CachedStmt(sqlite3 *db, const char *sql) {
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto &stmts = caches[db];
+        auto it = stmts.find(std::string_view(sql));
+        if (it == stmts.end()) {
+            sqlite3_stmt *fresh = nullptr;
+            if (sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &fresh, nullptr) != SQLITE_OK) {
+                std::cerr << "prepare failed: " << sqlite3_errmsg(db) << "\n";
+                sqlite3_finalize(fresh);
+                return;
+            }
+            it = stmts.emplace(sql, StmtCacheEntry{fresh, false}).first;
+        }
+        if (!it->second.in_use) {
+            it->second.in_use = true;
+            entry = &it->second;
+            stmt = entry->stmt;
+            return;
+        }
+    }
+    // the cached copy is checked out further up the call stack
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "prepare failed: " << sqlite3_errmsg(db) << "\n";
+        sqlite3_finalize(stmt);
+        stmt = nullptr;
+    }
+}
+
+CachedStmt::~CachedStmt() {
+    if (!stmt) return;
+    if (!entry) {
+        sqlite3_finalize(stmt);
+        return;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    entry->in_use = false;
+}
+
+void clear_statement_cache(sqlite3 *db) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = caches.find(db);
+    if (it == caches.end()) return;
+    for (auto &[sql, e] : it->second) {
+        sqlite3_finalize(e.stmt);
+    }
+    caches.erase(it);
+}
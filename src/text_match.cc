@@ -0,0 +1,128 @@
+#include "../include/text_match.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Base letters for U+00C0..U+00FF, indexed by the second UTF-8 byte minus
+// 0x80; 0 keeps the character (Æ, ×, Þ, ß, ÷).
+static const char latin1_base[64 + 1] =
+    "aaaaaa\0ceeeeiiiidnooooo\0ouuuuy\0\0"
+    "aaaaaa\0ceeeeiiiidnooooo\0ouuuuy\0y";
+
+std::string fold_text(std::string_view utf8) {
+    std::string out;
+    out.reserve(utf8.size());
+    for (size_t i = 0; i < utf8.size(); i++) {
+        unsigned char c = utf8[i];
+        if (c < 0x80) {
+            out += (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : char(c);
+            continue;
+        }
+        unsigned char next = i + 1 < utf8.size() ? utf8[i + 1] : 0;
+        if (c == 0xC3 && next >= 0x80 && next <= 0xBF && latin1_base[next - 0x80]) {
+            out += latin1_base[next - 0x80];
+            i++;
+        } else if ((c == 0xCC && next >= 0x80 && next <= 0xBF) || (c == 0xCD && next >= 0x80 && next <= 0xAF)) {
+            i++;    // combining diacritical mark, U+0300..U+036F
+        } else {
+            out += char(c);
+        }
+    }
+    return out;
+}
+
+namespace {
+
+using Scan = TextMatcher::Scan;
+
+// Each scan tests the start positions [0, starts) and reads the haystack up
+// to byte round_up(starts, block) + k - 2.
+
+bool scan_scalar(const char *h, size_t starts, const char *needle, size_t k) {
+    return std::string_view(h, starts + k - 1).find(std::string_view(needle, k)) != std::string_view::npos;
+}
+
+#if defined(__x86_64__)
+inline bool verify(uint32_t mask, const char *at, const char *needle, size_t k) {
+    while (mask) {
+        unsigned bit = __builtin_ctz(mask);
+        if (k <= 2 || memcmp(at + bit + 1, needle + 1, k - 2) == 0) return true;
+        mask &= mask - 1;
+    }
+    return false;
+}
+
+bool scan_sse2(const char *h, size_t starts, const char *needle, size_t k) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[k - 1]);
+    for (size_t i = 0; i < starts; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i + k - 1));
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        if (starts - i < 16) mask &= (1u << (starts - i)) - 1;
+        if (verify(mask, h + i, needle, k)) return true;
+    }
+    return false;
+}
+
+__attribute__((target("avx2")))
+bool scan_avx2(const char *h, size_t starts, const char *needle, size_t k) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[k - 1]);
+    for (size_t i = 0; i < starts; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i + k - 1));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                                              _mm256_cmpeq_epi8(b, last)));
+        if (starts - i < 32) mask &= (1u << (starts - i)) - 1;
+        if (verify(mask, h + i, needle, k)) return true;
+    }
+    return false;
+}
+
+struct Kernel {
+    Scan scan;
+    size_t block;
+};
+
+Kernel pick_kernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return {scan_avx2, 32};
+    return {scan_sse2, 16};
+}
+#else
+struct Kernel {
+    Scan scan;
+    size_t block;
+};
+
+Kernel pick_kernel() {
+    return {scan_scalar, 1};
+}
+#endif
+
+const Kernel &kernel() {
+    static const Kernel k = pick_kernel();
+    return k;
+}
+
+}
+
+TextMatcher::TextMatcher(std::string_view text)
+: pattern(fold_text(text)), scan(kernel().scan), block(kernel().block) {}
+
+bool TextMatcher::contains(std::string_view folded) const {
+    size_t k = pattern.size();
+    if (k == 0) return true;
+    if (folded.size() < k) return false;
+    size_t starts = folded.size() - k + 1;
+    // whole blocks stay in bounds; the rest goes to the scalar scan
+    size_t blocks = starts / block * block;
+    if (blocks > 0 && scan(folded.data(), blocks, pattern.data(), k)) return true;
+    if (blocks == starts) return false;
+    return scan_scalar(folded.data() + blocks, starts - blocks, pattern.data(), k);
+}
+
@@ -0,0 +1,111 @@
+#include "../include/timeline_view.h"
+
+static constexpr int TIMELINE_PAGE_SIZE = 50;
+
+TimelineView::TimelineView(DbExecutor &executor_, ChangeFeed &feed_, int service_id_, int user_id_)
+: Gtk::Box(Gtk::Orientation::VERTICAL, 6), executor(executor_), feed(feed_),
+  service_id(service_id_), user_id(user_id_)
+{
+    note_entry.set_placeholder_text("Note");
+    note_entry.set_hexpand(true);
+    add_btn.get_style_context()->add_class("primary");
+    note_row.append(note_entry);
+    note_row.append(add_btn);
+    append(note_row);
+
+    empty_label.set_halign(Gtk::Align::START);
+    entries.append(empty_label);
+    scroller.set_child(entries);
+    scroller.set_policy(Gtk::PolicyType::NEVER, Gtk::PolicyType::AUTOMATIC);
+    scroller.set_min_content_height(200);
+    scroller.set_vexpand(true);
+    append(scroller);
+
+    add_btn.signal_clicked().connect(sigc::mem_fun(*this, &TimelineView::add_note));
+    note_entry.signal_activate().connect(sigc::mem_fun(*this, &TimelineView::add_note));
+    scroller.signal_edge_reached().connect([this](Gtk::PositionType pos) {
+        if (pos == Gtk::PositionType::BOTTOM) load_more();
+    });
+    subscription = feed.subscribe([this](const ChangeSet &changes) { on_changes(changes); });
+
+    load_more();
+}
+
+TimelineView::~TimelineView() {
+    *alive = false;
+    feed.unsubscribe(subscription);
+}
+
+void TimelineView::load_more() {
+    if (loading || at_end) return;
+    loading = true;
+    std::weak_ptr<bool> guard = alive;
+    executor.run_read([id = service_id, after = next](sqlite3 *db) {
+        return get_timeline_page(id, after, TIMELINE_PAGE_SIZE, db);
+    }, [this, guard](TimelinePage page) {
+        if (guard.expired()) return;
+        loading = false;
+        next = page.next;
+        at_end = !next;
+        for (const auto &e : page.entries) show_entry(e, false);
+    });
+}
+
+void TimelineView::on_changes(const ChangeSet &changes) {
+    std::vector<int> added;
+    for (const auto &c : changes) {
+        if (c.table == "service_history" && c.op == ChangeOp::Insert) added.push_back(int(c.rowid));
+    }
+    if (added.empty()) return;
+    std::weak_ptr<bool> guard = alive;
+    executor.run_read([added](sqlite3 *db) {
+        std::vector<TimelineEntry> out;
+        for (int id : added) {
+            if (auto e = get_timeline_entry(id, db)) out.push_back(std::move(*e));
+        }
+        return out;
+    }, [this, guard](std::vector<TimelineEntry> found) {
+        if (guard.expired()) return;
+        for (const auto &e : found) {
+            if (e.service_id == service_id) show_entry(e, true);
+        }
+    });
+}
+
+void TimelineView::add_note() {
+    std::string note = note_entry.get_text();
+    if (note.empty()) return;
+    add_btn.set_sensitive(false);
+    std::weak_ptr<bool> guard = alive;
+    executor.run_write([id = service_id, user = user_id, note](sqlite3 *db) {
+        return add_timeline_entry(id, user, note, std::nullopt, db);
+    }, [this, guard](bool ok) {
+        if (guard.expired()) return;
+        add_btn.set_sensitive(true);
+        if (ok) note_entry.set_text("");
+        else std::cerr << "failed to add note to service " << service_id << "\n";
+    });
+}
+
+void TimelineView::show_entry(const TimelineEntry &e, bool at_top) {
+    if (!shown.insert(e.history_id).second) return;
+    if (empty_label.get_parent()) entries.remove(empty_label);
+
+    std::string header = e.created_at;
+    if (!e.user_name.empty()) header += "   " + e.user_name;
+    if (e.status) header += std::string("   status: ") + status_name(*e.status);
+
+    auto row = Gtk::make_managed<Gtk::Box>(Gtk::Orientation::VERTICAL, 2);
+    row->get_style_context()->add_class("row");
+    auto title = Gtk::make_managed<Gtk::Label>(header);
+    title->set_halign(Gtk::Align::START);
+    row->append(*title);
+    if (!e.note.empty()) {
+        auto note = Gtk::make_managed<Gtk::Label>(e.note);
+        note->set_halign(Gtk::Align::START);
+        note->set_wrap(true);
+        row->append(*note);
+    }
+    if (at_top) entries.prepend(*row);
+    else entries.append(*row);
+}